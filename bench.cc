@@ -0,0 +1,174 @@
+/*
+ * ----------------------------------------------------------------------------
+ * "THE BEER-WARE LICENSE" (Revision 42):
+ * Samuel Bourasseau wrote this file. As long as you retain this notice you
+ * can do whatever you want with this stuff. If we meet some day, and you think
+ * this stuff is worth it, you can buy me a beer in return.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <quick_vdb.hpp>
+
+
+static constexpr std::size_t kLeafSide = 3u;
+static constexpr std::size_t kBranch1Side = 5u;
+using DenseVDB_t = quick_vdb::RootNode<quick_vdb::BranchNode<quick_vdb::LeafNode<kLeafSide>, kBranch1Side>>;
+using CompactVDB_t = quick_vdb::RootNode<quick_vdb::CompactBranchNode<quick_vdb::LeafNode<kLeafSide>, kBranch1Side>>;
+
+static constexpr std::size_t kQueryCount = 1u << 22u;
+
+// Sparse : uniformly scattered voxels, mostly one per branch
+static std::vector<quick_vdb::Position_t> SparsePoints()
+{
+	std::mt19937_64 rng{ 42u };
+	std::uniform_int_distribution<quick_vdb::Integer_t> coord{ -4096, 4095 };
+	std::vector<quick_vdb::Position_t> points(1u << 11u);
+	for (quick_vdb::Position_t &p : points)
+		p = { coord(rng), coord(rng), coord(rng) };
+	return points;
+}
+
+// Surface : a sphere shell, the typical occupancy of a scanned scene
+static std::vector<quick_vdb::Position_t> SurfacePoints()
+{
+	constexpr quick_vdb::Integer_t kRadius = 400;
+	std::vector<quick_vdb::Position_t> points{};
+	for (quick_vdb::Integer_t z = -kRadius; z <= kRadius; ++z)
+		for (quick_vdb::Integer_t y = -kRadius; y <= kRadius; ++y)
+		{
+			quick_vdb::Integer_t const r2 = kRadius * kRadius - z * z - y * y;
+			if (r2 < 0)
+				continue;
+			quick_vdb::Integer_t const x = (quick_vdb::Integer_t)std::sqrt((double)r2);
+			points.push_back({ x, y, z });
+			points.push_back({ -x, y, z });
+		}
+	return points;
+}
+
+template <typename VDB>
+void Run(char const *_layout, char const *_scene, std::vector<quick_vdb::Position_t> const &_points)
+{
+	VDB vdb{};
+	for (quick_vdb::Position_t const &p : _points)
+		vdb.set(p);
+
+	std::size_t active = 0u;
+	vdb.forEachLeaf([&](typename VDB::LeafT &_leaf, quick_vdb::Position_t const&) {
+		active += _leaf.activeBits().count();
+	});
+
+	// Half of the queries hit active voxels, the other half their neighbourhood
+	std::mt19937_64 rng{ 7u };
+	std::uniform_int_distribution<std::size_t> pick{ 0u, _points.size() - 1u };
+	std::uniform_int_distribution<quick_vdb::Integer_t> jitter{ -8, 8 };
+	std::vector<quick_vdb::Position_t> queries(kQueryCount);
+	for (std::size_t i = 0u; i < kQueryCount; ++i)
+	{
+		queries[i] = _points[pick(rng)];
+		if (i & 1u)
+			queries[i] = { queries[i][0] + jitter(rng), queries[i][1] + jitter(rng), queries[i][2] + jitter(rng) };
+	}
+
+	std::size_t hits = 0u;
+	auto const start = std::chrono::steady_clock::now();
+	for (quick_vdb::Position_t const &q : queries)
+		hits += vdb.get(q);
+	auto const stop = std::chrono::steady_clock::now();
+	double const ns = std::chrono::duration<double, std::nano>(stop - start).count() / (double)kQueryCount;
+
+	// Writes go to the same positions, about half of them on already active voxels
+	auto const set_start = std::chrono::steady_clock::now();
+	for (quick_vdb::Position_t const &q : queries)
+		vdb.set(q);
+	auto const set_stop = std::chrono::steady_clock::now();
+	double const set_ns = std::chrono::duration<double, std::nano>(set_stop - set_start).count() / (double)kQueryCount;
+
+	std::size_t const memory = vdb.memoryUsage();
+	std::cout << _layout << " " << _scene
+			  << " : active " << active
+			  << ", memory " << memory / 1024u << " KB"
+			  << ", bytes per active voxel " << (double)memory / (double)active
+			  << ", get " << ns << " ns"
+			  << " (" << hits << " hits)"
+			  << ", set " << set_ns << " ns" << std::endl;
+}
+
+// Each producer fills its own slab of the grid through its own writer.
+// Returns the throughput in Mwrites/s, scaling is reported against _baseline
+// when it is not zero.
+template <typename Child>
+double RunConcurrent(unsigned _thread_count, double _baseline)
+{
+	constexpr quick_vdb::Integer_t kSlabSide = 256;
+	quick_vdb::ConcurrentRootNode<Child> grid{};
+
+	auto const start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads{};
+	for (unsigned t = 0u; t < _thread_count; ++t)
+		threads.emplace_back([&grid, t]() {
+			typename quick_vdb::ConcurrentRootNode<Child>::Writer writer{ grid };
+			quick_vdb::Integer_t const offset = (quick_vdb::Integer_t)t * kSlabSide;
+			for (quick_vdb::Integer_t z = 0; z < kSlabSide; ++z)
+				for (quick_vdb::Integer_t y = 0; y < kSlabSide; ++y)
+					for (quick_vdb::Integer_t x = 0; x < kSlabSide; x += 2)
+						writer.set({ offset + x, y, z });
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+	auto const stop = std::chrono::steady_clock::now();
+
+	double const seconds = std::chrono::duration<double>(stop - start).count();
+	double const writes = (double)_thread_count * (double)(kSlabSide * kSlabSide * kSlabSide / 2);
+	double const throughput = writes / seconds / 1e6;
+	std::cout << "concurrent writers " << _thread_count
+			  << " : " << throughput << " Mwrites/s";
+	if (_baseline > 0.0)
+		std::cout << ", speedup " << throughput / _baseline
+				  << ", efficiency " << throughput / _baseline / (double)_thread_count;
+	std::cout << std::endl;
+	return throughput;
+}
+
+// Usage : qvdb_bench [max_writers]
+// Concurrent writes are measured for 1, 2, 4, ... producers up to max_writers,
+// hardware_concurrency() by default. A larger value oversubscribes the cores.
+int main(int argc, char **argv)
+{
+#ifdef QVDB_ENABLE_JOURNAL
+	std::cout << "journal compiled in, none attached" << std::endl;
+#else
+	std::cout << "journal compiled out" << std::endl;
+#endif
+
+	std::vector<quick_vdb::Position_t> const sparse = SparsePoints();
+	std::vector<quick_vdb::Position_t> const surface = SurfacePoints();
+
+	Run<DenseVDB_t>("dense  ", "sparse ", sparse);
+	Run<CompactVDB_t>("compact", "sparse ", sparse);
+	Run<DenseVDB_t>("dense  ", "surface", surface);
+	Run<CompactVDB_t>("compact", "surface", surface);
+
+	unsigned max_writers = std::thread::hardware_concurrency();
+	if (argc > 1)
+		max_writers = (unsigned)std::strtoul(argv[1], nullptr, 10);
+	if (max_writers == 0u)
+		max_writers = 1u;
+	std::cout << "hardware threads " << std::thread::hardware_concurrency() << std::endl;
+	double baseline = 0.0;
+	for (unsigned thread_count = 1u; thread_count <= max_writers; thread_count *= 2u)
+	{
+		double const throughput = RunConcurrent<CompactVDB_t::ChildT>(thread_count, baseline);
+		if (thread_count == 1u)
+			baseline = throughput;
+	}
+	return 0;
+}
@@ -9,11 +9,28 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace quick_vdb {
 
@@ -28,15 +45,153 @@ struct Box_t
     Extent_t extent;
 };
 
+// Axis aligned quad lying on a boundary between an active and an inactive voxel.
+// Corners are counter clockwise when seen from the inactive side.
+struct Quad_t
+{
+    std::array<Position_t, 4u> corners;
+    unsigned axis;
+    bool positive; // normal points toward +axis
+};
+
+using Triangle_t = std::array<Position_t, 3u>;
+
+// Closest active voxel found by a proximity query, distance is euclidean in voxels
+struct NearestResult_t
+{
+    Position_t position;
+    double distance;
+    bool found;
+};
+
+// Lexicographic order on z, y, x
+inline bool PositionLess_(Position_t const &_lhs, Position_t const &_rhs)
+{
+    if (_lhs[2] != _rhs[2]) return _lhs[2] < _rhs[2];
+    if (_lhs[1] != _rhs[1]) return _lhs[1] < _rhs[1];
+    return _lhs[0] < _rhs[0];
+}
+
+struct PositionHash
+{
+    std::size_t operator()(Position_t const &_p) const
+    {
+        std::uint64_t hash = (std::uint64_t)_p[0] * 0x9e3779b97f4a7c15ull;
+        hash = (hash ^ (std::uint64_t)_p[1]) * 0xc2b2ae3d27d4eb4full;
+        hash = (hash ^ (std::uint64_t)_p[2]) * 0x165667b19e3779f9ull;
+        return (std::size_t)(hash ^ (hash >> 32u));
+    }
+};
+
 struct CacheEntry
 {
     Position_t base;
     void* node;
 };
 
+// Records the leaves and tiles modified since the last checkpoint.
+// Tile records keep the uniform value the region had when it was recorded
+// and a sequence number, so that they can be replayed in order.
+// Attached to a RootNode with setJournal() when QVDB_ENABLE_JOURNAL is defined.
+class ChangeJournal
+{
+public:
+    struct TileRecord
+    {
+        std::uint64_t sequence;
+        bool active;
+    };
+    using TileMap_t = std::unordered_map<Position_t, TileRecord, PositionHash>;
+
+    void recordLeaf(Position_t const &_leaf_base)
+    {
+        leaves_.insert(_leaf_base);
+    }
+
+    void recordTile(Position_t const &_base, unsigned _level, bool const _active)
+    {
+        if (_level >= tiles_.size())
+            tiles_.resize(_level + 1u);
+        tiles_[_level][_base] = TileRecord{ sequence_++, _active };
+    }
+
+    void recordClear()
+    {
+        checkpoint();
+        cleared_ = true;
+    }
+
+    void checkpoint()
+    {
+        leaves_.clear();
+        tiles_.clear();
+        cleared_ = false;
+    }
+
+    bool empty() const
+    {
+        return !cleared_ && leaves_.empty() && tiles_.empty();
+    }
+
+    bool cleared() const { return cleared_; }
+    std::unordered_set<Position_t, PositionHash> const &leaves() const { return leaves_; }
+    // Indexed by level, level 0 being leaf sized tiles
+    std::vector<TileMap_t> const &tiles() const { return tiles_; }
+
+private:
+    std::unordered_set<Position_t, PositionHash> leaves_{};
+    std::vector<TileMap_t> tiles_{};
+    std::uint64_t sequence_ = 0u;
+    bool cleared_ = false;
+};
+
+// Changes extracted from a journal, to be applied on a copy of the journaled tree.
+// Tiles are replayed in order, then leaves are overwritten with their latest content.
+template <typename LeafT>
+struct Delta
+{
+    struct Tile
+    {
+        Position_t base;
+        unsigned level;
+        bool active;
+    };
+
+    struct Leaf
+    {
+        Position_t base;
+        typename LeafT::Bits_t bits;
+    };
+
+    bool cleared = false;
+    std::vector<Tile> tiles{};
+    std::vector<Leaf> leaves{};
+};
+
 template <unsigned Size>
 struct Bitset;
 
+enum class eLodRule
+{
+    kAnyOccupied, // a coarse voxel is active when any of its 8 fine voxels is
+    kMajority,    // a coarse voxel is active when at least half of its 8 fine voxels are
+};
+
+template <typename VDB>
+class LodPyramid;
+
+template <typename VDB>
+class BakedView;
+
+template <typename VDB>
+class BakedTree;
+
+template <typename VDB>
+class ProximityQuery;
+
+template <typename Child, unsigned Log2ShardCount = 6u>
+class ConcurrentRootNode;
+
 #ifndef QVDB_STD_BITSET
 template <unsigned Size>
 using Bitset_t = Bitset<Size>;
@@ -45,6 +200,183 @@ template <unsigned Size>
 using Bitset_t = std::bitset<Size>;
 #endif
 
+// Parallel traversals, tile visits, meshing, levels of detail, baking, compact children
+// and proximity queries read the node bitsets one 64 bit word at a time. std::bitset does
+// not expose its words, these features are unavailable when QVDB_STD_BITSET is defined.
+template <typename Bits>
+struct HasWordStorage_ : std::false_type {};
+
+template <unsigned Size>
+struct HasWordStorage_<Bitset<Size>> : std::true_type {};
+
+inline unsigned Popcount_(std::uint64_t _v)
+{
+#ifdef _MSC_VER
+    return (unsigned)__popcnt64(_v);
+#else
+    return (unsigned)__builtin_popcountll(_v);
+#endif
+}
+
+// _v must be non zero
+inline unsigned Ctz_(std::uint64_t _v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, _v);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctzll(_v);
+#endif
+}
+
+// Minimal work-stealing thread pool used by the parallel traversals.
+// Each worker owns a deque, pops its own work LIFO and steals FIFO from the
+// others when it runs dry. Threads outside the pool push to a shared slot.
+// wait() blocks until every pushed task has completed, the calling thread
+// helps executing tasks meanwhile. It must not be called from within a task.
+class WorkStealingPool
+{
+public:
+    using Task_t = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned _worker_count = DefaultWorkerCount_())
+        : queue_count_{ _worker_count + 1u },
+          queues_{ new Queue_[_worker_count + 1u] }
+    {
+        workers_.reserve(_worker_count);
+        for (unsigned i = 1u; i <= _worker_count; ++i)
+            workers_.emplace_back([this, i]() { WorkerLoop_(i); });
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        sleep_cv_.notify_all();
+        for (std::thread &worker : workers_)
+            worker.join();
+    }
+
+    WorkStealingPool(WorkStealingPool const&) = delete;
+    WorkStealingPool &operator=(WorkStealingPool const&) = delete;
+
+    unsigned threadCount() const { return queue_count_; }
+
+    void push(Task_t &&_task)
+    {
+        ++pending_;
+        Queue_ &queue = queues_[LocalIndex_()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex_);
+            queue.tasks_.push_back(std::move(_task));
+        }
+        ++queued_;
+
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        sleep_cv_.notify_one();
+    }
+
+    void wait()
+    {
+        unsigned const index = LocalIndex_();
+        while (pending_.load() != 0u)
+        {
+            if (!RunOne_(index))
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Queue_
+    {
+        std::mutex mutex_;
+        std::deque<Task_t> tasks_;
+    };
+
+    static unsigned DefaultWorkerCount_()
+    {
+        unsigned const hardware = std::thread::hardware_concurrency();
+        return (hardware > 1u) ? hardware - 1u : 0u;
+    }
+
+    unsigned LocalIndex_() const
+    {
+        return (tl_pool_ == this) ? tl_index_ : 0u;
+    }
+
+    bool TryPop_(unsigned _index, Task_t &_task, bool _steal)
+    {
+        Queue_ &queue = queues_[_index];
+        std::lock_guard<std::mutex> lock(queue.mutex_);
+        if (queue.tasks_.empty())
+            return false;
+
+        if (_steal)
+        {
+            _task = std::move(queue.tasks_.front());
+            queue.tasks_.pop_front();
+        }
+        else
+        {
+            _task = std::move(queue.tasks_.back());
+            queue.tasks_.pop_back();
+        }
+        return true;
+    }
+
+    bool RunOne_(unsigned _index)
+    {
+        Task_t task{};
+        bool found = TryPop_(_index, task, false);
+        for (unsigned i = 1u; i < queue_count_ && !found; ++i)
+            found = TryPop_((_index + i) % queue_count_, task, true);
+
+        if (!found)
+            return false;
+
+        --queued_;
+        task();
+        --pending_;
+        return true;
+    }
+
+    void WorkerLoop_(unsigned _index)
+    {
+        tl_pool_ = this;
+        tl_index_ = _index;
+        for (;;)
+        {
+            if (RunOne_(_index))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_cv_.wait(lock, [this]() { return stop_ || queued_.load() != 0u; });
+            if (stop_)
+                return;
+        }
+    }
+
+private:
+    unsigned const queue_count_;
+    std::unique_ptr<Queue_[]> queues_;
+    std::vector<std::thread> workers_{};
+
+    std::atomic<std::size_t> pending_{ 0u };
+    std::atomic<std::size_t> queued_{ 0u };
+
+    std::mutex sleep_mutex_{};
+    std::condition_variable sleep_cv_{};
+    bool stop_ = false;
+
+    static inline thread_local WorkStealingPool const *tl_pool_ = nullptr;
+    static inline thread_local unsigned tl_index_ = 0u;
+};
+
 template <typename T>
 static Position_t NodeBase_(Position_t const& _p)
 {
@@ -62,8 +394,9 @@ class LeafNode
 public:
     static constexpr unsigned kNodeLevel = 0u;
     using ChildT = void;
+    using LeafT = LeafNode<Log2Side>;
 
-    void GetLeafPointer(Position_t const& _p, std::size_t* _size, std::uint64_t const** _out)
+    void GetLeafPointer(Position_t const&, std::size_t* _size, std::uint64_t const** _out)
     {
         *_size = active_bits_.kArraySize;
         *_out = active_bits_.storage;
@@ -73,14 +406,14 @@ public:
     static constexpr std::size_t kLog2Side = Log2Side;
     LeafNode() = default;
 
-    explicit LeafNode(bool _active, Position_t const& _base)
-        : base_{ _base } {
+    // Leaves do not store their base, it is known from the traversal
+    explicit LeafNode(bool _active, Position_t const&) {
         if (_active)
             active_bits_.set();
     }
 
 public:
-    void set(CacheEntry*, Position_t const &_p, bool const _v = true)
+    void set(CacheEntry*, Position_t const &_p, bool const _v = true, ChangeJournal* = nullptr)
     {
         std::size_t const bit_index = BitIndex_(_p);
         active_bits_.set(bit_index, _v);
@@ -102,7 +435,54 @@ public:
         return active_bits_.none();
     }
 
+public:
+    using Bits_t = Bitset_t<1u << (kLog2Side * 3u)>;
+
+    Bits_t const &activeBits() const { return active_bits_; }
+
+    void SetBits(Bits_t const &_bits)
+    {
+        active_bits_ = _bits;
+    }
+
+    void SetTile(Position_t const&, unsigned, bool const _v)
+    {
+        if (_v)
+            active_bits_.set();
+        else
+            active_bits_.reset();
+    }
+
+    template <unsigned Level, typename F>
+    void ForEachNode(Position_t const &_base, F &_f)
+    {
+        static_assert(Level == kNodeLevel, "Level is deeper than the tree");
+        _f(*this, _base);
+    }
+
+    template <unsigned Level, typename F>
+    void ForEachNode(WorkStealingPool&, Position_t const &_base, F &_f)
+    {
+        ForEachNode<Level>(_base, _f);
+    }
+
+    template <typename F>
+    void ForEachActiveTile(Position_t const&, F&)
+    {
+    }
+
+    std::size_t memoryUsage() const
+    {
+        return sizeof(*this);
+    }
+
 private:
+    template <typename VDB>
+    friend class BakedView;
+
+    template <typename VDB>
+    friend class ProximityQuery;
+
     static std::size_t const BitIndex_(Position_t const &_p)
     {
         // x, y, and z being local coordinates ( [0, 2^kLog2Side[ )
@@ -113,24 +493,108 @@ private:
             (_p[2] & kLocalMask) << kLog2Side*2u;
     }
 
-
 private:
     Bitset_t<1u << (kLog2Side * 3u)> active_bits_{};
-    Position_t base_;
 };
 
-template <typename Child, std::size_t Log2Side>
+// Child storage of a BranchNode, one pointer slot per child position.
+// The child bits of the owner are passed along so that both layouts share an interface.
+template <typename Child, std::size_t Count>
+class DenseChildren
+{
+public:
+    template <typename Bits_t>
+    Child *at(Bits_t const&, std::size_t _index) const
+    {
+        return slots_[_index].get();
+    }
+
+    template <typename Bits_t>
+    void insert(Bits_t const&, std::size_t _index, Child *_child)
+    {
+        slots_[_index].reset(_child);
+    }
+
+    template <typename Bits_t>
+    void erase(Bits_t const&, std::size_t _index)
+    {
+        slots_[_index].reset(nullptr);
+    }
+
+    std::size_t heapUsage() const { return 0u; }
+
+private:
+    std::array<std::unique_ptr<Child>, Count> slots_;
+};
+
+// Child storage holding existing children only, ordered by their index.
+// The position of a child is its rank among the child bits, computed from the
+// number of children preceding each bit word and a popcount within the word.
+// insert() must be called before the child bit is set, erase() before or after it is cleared.
+template <typename Child, std::size_t Count>
+class CompactChildren
+{
+public:
+    template <typename Bits_t>
+    Child *at(Bits_t const &_child_bits, std::size_t _index) const
+    {
+        return children_[Rank_(_child_bits, _index)].get();
+    }
+
+    template <typename Bits_t>
+    void insert(Bits_t const &_child_bits, std::size_t _index, Child *_child)
+    {
+        std::size_t const rank = Rank_(_child_bits, _index);
+        children_.emplace(children_.begin() + rank, _child);
+        for (std::size_t w = _index / 64u + 1u; w < kWordCount; ++w)
+            ++ranks_[w];
+    }
+
+    template <typename Bits_t>
+    void erase(Bits_t const &_child_bits, std::size_t _index)
+    {
+        std::size_t const rank = Rank_(_child_bits, _index);
+        children_.erase(children_.begin() + rank);
+        for (std::size_t w = _index / 64u + 1u; w < kWordCount; ++w)
+            --ranks_[w];
+    }
+
+    std::size_t heapUsage() const
+    {
+        return children_.capacity() * sizeof(std::unique_ptr<Child>);
+    }
+
+private:
+    static constexpr std::size_t kWordCount = Count / 64u;
+
+    // Number of children with an index lower than _index
+    template <typename Bits_t>
+    std::size_t Rank_(Bits_t const &_child_bits, std::size_t _index) const
+    {
+        static_assert(HasWordStorage_<Bits_t>::value, "CompactChildren " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+        std::uint64_t const below = _child_bits.storage[_index / 64u] & ((1ull << (_index & 63u)) - 1ull);
+        return ranks_[_index / 64u] + Popcount_(below);
+    }
+
+private:
+    std::vector<std::unique_ptr<Child>> children_{};
+    std::array<std::uint32_t, kWordCount> ranks_{};
+};
+
+template <typename Child, std::size_t Log2Side,
+          template <typename, std::size_t> class Children = DenseChildren>
 class BranchNode
 {
 public:
     static constexpr unsigned kNodeLevel = Child::kNodeLevel + 1u;
     using ChildT = Child;
+    using LeafT = typename Child::LeafT;
 
     void GetLeafPointer(Position_t const& _p, std::size_t* _size, std::uint64_t const** _out)
     {
         std::size_t const bit_index = BitIndex_(_p);
         if (child_bits_.test(bit_index))
-            children_[bit_index]->GetLeafPointer(_p, _size, _out);
+            ChildAt_(bit_index)->GetLeafPointer(_p, _size, _out);
         else
         {
             *_size = 0;
@@ -143,15 +607,15 @@ public:
     static constexpr std::size_t kLog2Side = Log2Side + Child::kLog2Side;
     BranchNode() = default;
 
-    explicit BranchNode(bool _active, Position_t const& _base)
-        : base_{ _base } {
+    explicit BranchNode(bool _active, Position_t const&) {
         if (_active)
             active_bits_.set();
     }
 
 public:
 
-    void set(CacheEntry* _root_cache, Position_t const &_p, bool const _v = true)
+    void set(CacheEntry* _root_cache, Position_t const &_p, bool const _v = true,
+             ChangeJournal* _journal = nullptr)
     {
         std::size_t const bit_index = BitIndex_(_p);
         if (!child_bits_.test(bit_index))
@@ -159,41 +623,51 @@ public:
             if (_v != active_bits_.test(bit_index))
             {
                 Position_t child_base = ChildBase_(_p);
-                children_[bit_index].reset(new Child(!_v, child_base));
+                children_.insert(child_bits_, bit_index, new Child(!_v, child_base));
 
-                children_[bit_index]->set(_root_cache, _p, _v);
+#ifdef QVDB_ENABLE_JOURNAL
+                if (_journal)
+                    _journal->recordTile(child_base, Child::kNodeLevel, !_v);
+#endif
+
+                ChildAt_(bit_index)->set(_root_cache, _p, _v, _journal);
                 child_bits_.set(bit_index, true);
 
 #ifdef QVDB_ENABLE_CACHE
                 _root_cache[kNodeLevel-1u] = CacheEntry{
                     child_base,
-                    (void*)children_[bit_index].get()
+                    (void*)ChildAt_(bit_index)
                 };
 #endif
             }
         }
         else
         {
-            children_[bit_index]->set(_root_cache, _p, _v);
+            ChildAt_(bit_index)->set(_root_cache, _p, _v, _journal);
 
-            bool all = children_[bit_index]->all();
-            bool none = children_[bit_index]->none();
+            bool all = ChildAt_(bit_index)->all();
+            bool none = ChildAt_(bit_index)->none();
             if (all != none)
             {
                 active_bits_.set(bit_index, all);
                 child_bits_.set(bit_index, false);
 
+#ifdef QVDB_ENABLE_JOURNAL
+                if (_journal)
+                    _journal->recordTile(ChildBase_(_p), Child::kNodeLevel, all);
+#endif
+
 #if 0
-                if (_root_cache[kNodeLevel-1u] == (void*)children_[bit_index].get())
+                if (_root_cache[kNodeLevel-1u] == (void*)ChildAt_(bit_index))
                     _root_cache[kNodeLevel-1u] = nullptr;
 #endif
-                children_[bit_index].reset(nullptr);
+                children_.erase(child_bits_, bit_index);
             }
 
 #ifdef QVDB_ENABLE_CACHE
             _root_cache[kNodeLevel-1u] = CacheEntry{
                 ChildBase_(_p),
-                (void*)children_[bit_index].get()
+                child_bits_.test(bit_index) ? (void*)ChildAt_(bit_index) : nullptr
             };
 #endif
         }
@@ -207,10 +681,10 @@ public:
 #ifdef QVDB_ENABLE_CACHE
             _root_cache[kNodeLevel-1u] = CacheEntry{
                 ChildBase_(_p),
-                (void*)children_[bit_index].get()
+                (void*)ChildAt_(bit_index)
             };
 #endif
-            return children_[bit_index]->get(_root_cache, _p);
+            return ChildAt_(bit_index)->get(_root_cache, _p);
         }
         else
             return active_bits_.test(bit_index);
@@ -226,43 +700,207 @@ public:
         return active_bits_.none() && child_bits_.none();
     }
 
-private:
-    static constexpr std::size_t kInternalLog2Side = Log2Side;
+    // Makes the whole level _level node region containing _p uniform
+    void SetTile(Position_t const &_p, unsigned _level, bool const _v)
+    {
+        std::size_t const bit_index = BitIndex_(_p);
+        if (_level == Child::kNodeLevel)
+        {
+            if (child_bits_.test(bit_index))
+                children_.erase(child_bits_, bit_index);
+            child_bits_.set(bit_index, false);
+            active_bits_.set(bit_index, _v);
+            return;
+        }
 
-    static std::size_t const BitIndex_(Position_t const &_p)
+        if (!child_bits_.test(bit_index))
+        {
+            if (_v == active_bits_.test(bit_index))
+                return;
+
+            children_.insert(child_bits_, bit_index, new Child(active_bits_.test(bit_index), ChildBase_(_p)));
+            child_bits_.set(bit_index, true);
+        }
+
+        ChildAt_(bit_index)->SetTile(_p, _level, _v);
+
+        bool all = ChildAt_(bit_index)->all();
+        bool none = ChildAt_(bit_index)->none();
+        if (all != none)
+        {
+            active_bits_.set(bit_index, all);
+            child_bits_.set(bit_index, false);
+            children_.erase(child_bits_, bit_index);
+        }
+    }
+
+    // Replaces the leaf containing _p, _bits is expected to be neither full nor empty
+    void SetLeaf(Position_t const &_p, typename LeafT::Bits_t const &_bits)
     {
-        // z/Child::Nz + (y/Child::Ny) * Nz + (x/Child::Nx) * Nz*Ny
-        // computes position in terms of children and packs the result the same way as a LeafNode would
-        // x, y, and z are local coordinates as well ( [0, 2^kLog2Side[ )
-        // Nx, Ny, and Nz are bounds in terms of children ( [0, 2^kInternalLog2Side[ )
-        constexpr std::size_t kLocalMask = (1u << kLog2Side) - 1u;
-        return
-            ((_p[0] & kLocalMask) >> Child::kLog2Side) |
-            ((_p[1] & kLocalMask) >> Child::kLog2Side) << kInternalLog2Side |
-            ((_p[2] & kLocalMask) >> Child::kLog2Side) << kInternalLog2Side*2u;
+        std::size_t const bit_index = BitIndex_(_p);
+        if (!child_bits_.test(bit_index))
+        {
+            children_.insert(child_bits_, bit_index, new Child(active_bits_.test(bit_index), ChildBase_(_p)));
+            child_bits_.set(bit_index, true);
+        }
+
+        if constexpr (Child::kNodeLevel == 0u)
+            ChildAt_(bit_index)->SetBits(_bits);
+        else
+            ChildAt_(bit_index)->SetLeaf(_p, _bits);
     }
 
 public:
-    static Position_t ChildBase_(Position_t const& _p)
+    template <unsigned Level, typename F>
+    void ForEachNode(Position_t const &_base, F &_f)
     {
-        constexpr std::int64_t kChildLocalMask = (1u << Child::kLog2Side) - 1u;
-        return {
-            _p[0] & ~kChildLocalMask,
-            _p[1] & ~kChildLocalMask,
-            _p[2] & ~kChildLocalMask
-        };
+        static_assert(HasWordStorage_<Bits_t>::value, "Node traversal " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+        if constexpr (Level == kNodeLevel)
+            _f(*this, _base);
+        else
+        {
+            child_bits_.forEachSet([&](std::size_t _i) {
+                ChildAt_(_i)->template ForEachNode<Level>(ChildBaseFromIndex_(_base, _i), _f);
+            });
+        }
     }
 
+    template <unsigned Level, typename F>
+    void ForEachNode(WorkStealingPool &_pool, Position_t const &_base, F &_f)
+    {
+        static_assert(HasWordStorage_<Bits_t>::value, "Node traversal " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+        if constexpr (Level == kNodeLevel)
+            _f(*this, _base);
+        else if constexpr (Level == Child::kNodeLevel)
+        {
+            // Children are the visited nodes, hand them out one bitset word at a time
+            for (std::size_t w = 0u; w < kArraySize_; ++w)
+            {
+                if (child_bits_.storage[w] == 0ull)
+                    continue;
+
+                _pool.push([this, _base, w, &_f]() {
+                    for (std::uint64_t word = child_bits_.storage[w]; word != 0ull; word &= word - 1ull)
+                    {
+                        std::size_t const i = w * 64u + Ctz_(word);
+                        _f(*ChildAt_(i), ChildBaseFromIndex_(_base, i));
+                    }
+                });
+            }
+        }
+        else
+        {
+            child_bits_.forEachSet([&](std::size_t _i) {
+                Child *child = ChildAt_(_i);
+                Position_t const child_base = ChildBaseFromIndex_(_base, _i);
+                _pool.push([child, child_base, &_pool, &_f]() {
+                    child->template ForEachNode<Level>(_pool, child_base, _f);
+                });
+            });
+        }
+    }
+
+    template <typename F>
+    void ForEachActiveTile(Position_t const &_base, F &_f)
+    {
+        static_assert(HasWordStorage_<Bits_t>::value, "Tile traversal " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+        constexpr Unsigned_t kTileSide = 1ull << Child::kLog2Side;
+        for (std::size_t w = 0u; w < kArraySize_; ++w)
+        {
+            std::uint64_t const tiles = active_bits_.storage[w] & ~child_bits_.storage[w];
+            for (std::uint64_t word = tiles; word != 0ull; word &= word - 1ull)
+            {
+                Box_t const tile{
+                    ChildBaseFromIndex_(_base, w * 64u + Ctz_(word)),
+                    Extent_t{ kTileSide, kTileSide, kTileSide }
+                };
+                _f(tile);
+            }
+        }
+
+        child_bits_.forEachSet([&](std::size_t _i) {
+            ChildAt_(_i)->ForEachActiveTile(ChildBaseFromIndex_(_base, _i), _f);
+        });
+    }
+
+public:
+    static Position_t ChildBase_(Position_t const& _p)
+    {
+        constexpr std::int64_t kChildLocalMask = (1u << Child::kLog2Side) - 1u;
+        return {
+            _p[0] & ~kChildLocalMask,
+            _p[1] & ~kChildLocalMask,
+            _p[2] & ~kChildLocalMask
+        };
+    }
+
+    using Bits_t = Bitset_t<1u << (Log2Side * 3u)>;
+
+    Bits_t const &activeBits() const { return active_bits_; }
+    Bits_t const &childBits() const { return child_bits_; }
+    Child const *child(std::size_t _index) const { return ChildAt_(_index); }
+
+    std::size_t memoryUsage() const
+    {
+        static_assert(HasWordStorage_<Bits_t>::value, "memoryUsage() " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+        std::size_t usage = sizeof(*this) + children_.heapUsage();
+        child_bits_.forEachSet([&](std::size_t _i) {
+            usage += ChildAt_(_i)->memoryUsage();
+        });
+        return usage;
+    }
+
+private:
+    template <typename VDB>
+    friend class BakedView;
+
+    template <typename VDB>
+    friend class ProximityQuery;
+
+    static constexpr std::size_t kInternalLog2Side = Log2Side;
+
+    static std::size_t const BitIndex_(Position_t const &_p)
+    {
+        // z/Child::Nz + (y/Child::Ny) * Nz + (x/Child::Nx) * Nz*Ny
+        // computes position in terms of children and packs the result the same way as a LeafNode would
+        // x, y, and z are local coordinates as well ( [0, 2^kLog2Side[ )
+        // Nx, Ny, and Nz are bounds in terms of children ( [0, 2^kInternalLog2Side[ )
+        constexpr std::size_t kLocalMask = (1u << kLog2Side) - 1u;
+        return
+            ((_p[0] & kLocalMask) >> Child::kLog2Side) |
+            ((_p[1] & kLocalMask) >> Child::kLog2Side) << kInternalLog2Side |
+            ((_p[2] & kLocalMask) >> Child::kLog2Side) << kInternalLog2Side*2u;
+    }
+
+    // Inverse of BitIndex_, _base being the base of this node
+    static Position_t ChildBaseFromIndex_(Position_t const& _base, std::size_t _index)
+    {
+        constexpr std::size_t kInternalMask = (1u << kInternalLog2Side) - 1u;
+        return {
+            _base[0] + (Integer_t)((_index & kInternalMask) << Child::kLog2Side),
+            _base[1] + (Integer_t)(((_index >> kInternalLog2Side) & kInternalMask) << Child::kLog2Side),
+            _base[2] + (Integer_t)(((_index >> kInternalLog2Side*2u) & kInternalMask) << Child::kLog2Side)
+        };
+    }
+
+private:
+    Child *ChildAt_(std::size_t _index) const
+    {
+        return children_.at(child_bits_, _index);
+    }
 
 private:
     static constexpr std::size_t kSize = kInternalLog2Side * 3u;
-    std::array<std::unique_ptr<Child>, 1u << kSize> children_;
+    static constexpr std::size_t kArraySize_ = (1u << kSize) / 64u;
+    Children<Child, 1u << kSize> children_;
     Bitset_t<1u << kSize> active_bits_{};
     Bitset_t<1u << kSize> child_bits_{};
-
-    Position_t base_;
 };
 
+// BranchNode only storing the children it has
+template <typename Child, std::size_t Log2Side>
+using CompactBranchNode = BranchNode<Child, Log2Side, CompactChildren>;
+
 template <typename Child>
 class RootNode
 {
@@ -270,6 +908,7 @@ class RootNode
 public:
     static constexpr unsigned kNodeLevel = Child::kNodeLevel + 1u;
     using ChildT = Child;
+    using LeafT = typename Child::LeafT;
 
     void GetLeafPointer(Position_t const& _p, std::size_t* _size, std::uint64_t const** _out)
     {
@@ -321,15 +960,19 @@ public:
     RootNode()
     {
 #ifdef QVDB_ENABLE_CACHE
-        for (unsigned i = 0u; i < kNodeLevel; ++i)
-            node_cache_[i] = CacheEntry{ Position_t{}, nullptr };
+        InvalidateCache_();
 #endif
     }
 
     void set(Position_t const &_p, bool const _v = true)
     {
+#ifdef QVDB_ENABLE_JOURNAL
+        if (journal_)
+            journal_->recordLeaf(NodeBase_<LeafT>(_p));
+#endif
+
 #ifdef QVDB_ENABLE_CACHE
-        unsigned entry_index = ExecOnCache<SetOp>{}(*this, _p, nullptr, &node_cache_[0], _p, _v);
+        unsigned entry_index = ExecOnCache<SetOp>{}(*this, _p, nullptr, &node_cache_[0], _p, _v, Journal_());
         if (entry_index != -1u)
             return;
 #endif
@@ -350,10 +993,15 @@ public:
                 Position_t child_base = ChildBase_(_p);
                 data.child_.reset(new Child(data.active_, child_base));
 
+#ifdef QVDB_ENABLE_JOURNAL
+                if (journal_)
+                    journal_->recordTile(child_base, Child::kNodeLevel, data.active_);
+#endif
+
 #ifndef QVDB_ENABLE_CACHE
-                data.child_->set(nullptr, _p, _v);
+                data.child_->set(nullptr, _p, _v, Journal_());
 #else
-                data.child_->set(node_cache_, _p, _v);
+                data.child_->set(node_cache_, _p, _v, Journal_());
 
                 node_cache_[kNodeLevel-1u] = CacheEntry{
                     child_base,
@@ -366,9 +1014,9 @@ public:
         {
 
 #ifndef QVDB_ENABLE_CACHE
-            data.child_->set(nullptr, _p, _v);
+            data.child_->set(nullptr, _p, _v, Journal_());
 #else
-            data.child_->set(node_cache_, _p, _v);
+            data.child_->set(node_cache_, _p, _v, Journal_());
 #endif
 
             bool all = data.child_->all();
@@ -377,6 +1025,11 @@ public:
             {
                 data.active_ = all;
                 data.child_.reset(nullptr);
+
+#ifdef QVDB_ENABLE_JOURNAL
+                if (journal_)
+                    journal_->recordTile(ChildBase_(_p), Child::kNodeLevel, all);
+#endif
             }
 
 #ifdef QVDB_ENABLE_CACHE
@@ -428,6 +1081,257 @@ public:
     void clear()
     {
         root_map_.clear();
+#ifdef QVDB_ENABLE_CACHE
+        InvalidateCache_();
+#endif
+#ifdef QVDB_ENABLE_JOURNAL
+        if (journal_)
+            journal_->recordClear();
+#endif
+    }
+
+    // Sets the whole level _level node region containing _p to _v, level 0 being a leaf.
+    void setTile(Position_t const &_p, unsigned _level, bool const _v = true)
+    {
+#ifdef QVDB_ENABLE_JOURNAL
+        if (journal_)
+        {
+            std::int64_t const mask = (std::int64_t(1) << NodeLog2Side(_level)) - 1;
+            journal_->recordTile({ _p[0] & ~mask, _p[1] & ~mask, _p[2] & ~mask }, _level, _v);
+        }
+#endif
+
+        RootKey_t const key = RootKey_(_p);
+        typename RootMap_t::iterator nit = root_map_.find(key);
+        if (nit == root_map_.end())
+        {
+            if (!_v)
+                return;
+            nit = root_map_.emplace(key, RootData{ std::unique_ptr<Child>{}, false }).first;
+        }
+
+        RootData &data = nit->second;
+        if (_level == Child::kNodeLevel)
+        {
+            data.child_.reset(nullptr);
+            data.active_ = _v;
+        }
+        else
+        {
+            if (data.child_ == nullptr)
+            {
+                if (_v == data.active_)
+                    return;
+                data.child_.reset(new Child(data.active_, ChildBase_(_p)));
+            }
+
+            data.child_->SetTile(_p, _level, _v);
+
+            bool all = data.child_->all();
+            bool none = data.child_->none();
+            if (all != none)
+            {
+                data.active_ = all;
+                data.child_.reset(nullptr);
+            }
+        }
+
+#ifdef QVDB_ENABLE_CACHE
+        InvalidateCache_();
+#endif
+    }
+
+    // Replaces the content of the leaf containing _p.
+    void setLeaf(Position_t const &_p, typename LeafT::Bits_t const &_bits)
+    {
+        bool const all = _bits.all();
+        if (all || _bits.none())
+        {
+            setTile(_p, 0u, all);
+            return;
+        }
+
+#ifdef QVDB_ENABLE_JOURNAL
+        if (journal_)
+            journal_->recordLeaf(NodeBase_<LeafT>(_p));
+#endif
+
+        RootKey_t const key = RootKey_(_p);
+        typename RootMap_t::iterator nit = root_map_.find(key);
+        if (nit == root_map_.end())
+            nit = root_map_.emplace(key, RootData{ std::unique_ptr<Child>{}, false }).first;
+
+        RootData &data = nit->second;
+        if (data.child_ == nullptr)
+            data.child_.reset(new Child(data.active_, ChildBase_(_p)));
+
+        if constexpr (Child::kNodeLevel == 0u)
+            data.child_->SetBits(_bits);
+        else
+            data.child_->SetLeaf(_p, _bits);
+
+#ifdef QVDB_ENABLE_CACHE
+        InvalidateCache_();
+#endif
+    }
+
+#ifdef QVDB_ENABLE_JOURNAL
+    // Starts recording changes into _journal, nullptr stops recording
+    void setJournal(ChangeJournal *_journal)
+    {
+        journal_ = _journal;
+    }
+#endif
+
+    // Read only copy of the tree in a single relocatable buffer
+    BakedTree<RootNode<Child>> bake() const
+    {
+        return BakedTree<RootNode<Child>>{ *this };
+    }
+
+    using Delta_t = Delta<LeafT>;
+
+    // Content of the regions recorded in _journal
+    Delta_t extractDelta(ChangeJournal const &_journal)
+    {
+        Delta_t delta{};
+        delta.cleared = _journal.cleared();
+
+        std::vector<std::pair<std::uint64_t, typename Delta_t::Tile>> tiles{};
+        for (unsigned level = 0u; level < _journal.tiles().size(); ++level)
+            for (typename ChangeJournal::TileMap_t::value_type const &record : _journal.tiles()[level])
+                tiles.emplace_back(record.second.sequence,
+                                   typename Delta_t::Tile{ record.first, level, record.second.active });
+        std::sort(tiles.begin(), tiles.end(), [](auto const &_lhs, auto const &_rhs) {
+            return _lhs.first < _rhs.first;
+        });
+        delta.tiles.reserve(tiles.size());
+        for (auto const &tile : tiles)
+            delta.tiles.push_back(tile.second);
+
+        delta.leaves.reserve(_journal.leaves().size());
+        for (Position_t const &leaf_base : _journal.leaves())
+            delta.leaves.push_back(typename Delta_t::Leaf{ leaf_base, LeafPatch_(*this, leaf_base) });
+        std::sort(delta.leaves.begin(), delta.leaves.end(), [](auto const &_lhs, auto const &_rhs) {
+            return PositionLess_(_lhs.base, _rhs.base);
+        });
+
+        return delta;
+    }
+
+    void applyDelta(Delta_t const &_delta)
+    {
+        if (_delta.cleared)
+            clear();
+        for (typename Delta_t::Tile const &tile : _delta.tiles)
+            setTile(tile.base, tile.level, tile.active);
+        for (typename Delta_t::Leaf const &leaf : _delta.leaves)
+            setLeaf(leaf.base, leaf.bits);
+    }
+
+    // Closest active voxel to _p no further than _max_dist, tiles count as fully active boxes.
+    NearestResult_t nearestActive(Position_t const &_p, double _max_dist) const
+    {
+        return ProximityQuery<RootNode<Child>>::Nearest(*this, _p, _max_dist);
+    }
+
+    // Batched form, _out[i] is the result for _points[i]
+    void nearestActive(std::vector<Position_t> const &_points, double _max_dist,
+                       std::vector<NearestResult_t> &_out) const
+    {
+        ProximityQuery<RootNode<Child>>::NearestBatch(*this, nullptr, _points, _max_dist, _out);
+    }
+
+    void nearestActive(WorkStealingPool &_pool, std::vector<Position_t> const &_points, double _max_dist,
+                       std::vector<NearestResult_t> &_out) const
+    {
+        ProximityQuery<RootNode<Child>>::NearestBatch(*this, &_pool, _points, _max_dist, _out);
+    }
+
+    // Appends to _out every active voxel within _radius of _p, in z, y, x order
+    void activeWithinRadius(Position_t const &_p, double _radius, std::vector<Position_t> &_out) const
+    {
+        ProximityQuery<RootNode<Child>>::Radius(*this, _p, _radius, _out);
+    }
+
+    // Approximate heap and inline footprint of the tree, in bytes
+    std::size_t memoryUsage() const
+    {
+        std::size_t usage = sizeof(*this) + root_map_.bucket_count() * sizeof(void*);
+        for (typename RootMap_t::value_type const &entry : root_map_)
+        {
+            usage += sizeof(entry) + sizeof(void*);
+            if (entry.second.child_ != nullptr)
+                usage += entry.second.child_->memoryUsage();
+        }
+        return usage;
+    }
+
+    // Side of the nodes of the given level, level 0 being a leaf
+    static constexpr std::size_t NodeLog2Side(unsigned _level)
+    {
+        return NodeLog2Side_<Child>(_level);
+    }
+
+    // Calls _f(NodeT&, Position_t const& base) on every allocated node of the given level,
+    // Level 0 being the leaves.
+    template <unsigned Level, typename F>
+    void forEachNode(F &&_f)
+    {
+        static_assert(Level < kNodeLevel, "Level must be below the root");
+        for (typename RootMap_t::value_type &entry : root_map_)
+        {
+            if (entry.second.child_ != nullptr)
+                entry.second.child_->template ForEachNode<Level>(ChildBase_(entry.first), _f);
+        }
+    }
+
+    // Parallel overload, _f may be called concurrently from any thread of _pool.
+    template <unsigned Level, typename F>
+    void forEachNode(WorkStealingPool &_pool, F &&_f)
+    {
+        static_assert(Level < kNodeLevel, "Level must be below the root");
+        for (typename RootMap_t::value_type &entry : root_map_)
+        {
+            if (entry.second.child_ == nullptr)
+                continue;
+
+            Child *child = entry.second.child_.get();
+            Position_t const child_base = ChildBase_(entry.first);
+            _pool.push([child, child_base, &_pool, &_f]() {
+                child->template ForEachNode<Level>(_pool, child_base, _f);
+            });
+        }
+        _pool.wait();
+    }
+
+    // Calls _f(LeafT&, Position_t const& base) on every allocated leaf
+    template <typename F>
+    void forEachLeaf(F &&_f)
+    {
+        forEachNode<0u>(_f);
+    }
+
+    template <typename F>
+    void forEachLeaf(WorkStealingPool &_pool, F &&_f)
+    {
+        forEachNode<0u>(_pool, _f);
+    }
+
+    // Calls _f(Box_t const&) on every active tile, that is every active region
+    // stored as a single bit in its parent node.
+    template <typename F>
+    void forEachActiveTile(F &&_f)
+    {
+        constexpr Unsigned_t kTileSide = 1ull << Child::kLog2Side;
+        for (typename RootMap_t::value_type &entry : root_map_)
+        {
+            RootData &data = entry.second;
+            if (data.child_ != nullptr)
+                data.child_->ForEachActiveTile(ChildBase_(entry.first), _f);
+            else if (data.active_)
+                _f(Box_t{ ChildBase_(entry.first), Extent_t{ kTileSide, kTileSide, kTileSide } });
+        }
     }
 
 private:
@@ -446,10 +1350,41 @@ private:
         return (Position_t)RootKey_(_p);
     }
 
+    template <typename T>
+    static constexpr std::size_t NodeLog2Side_(unsigned _level)
+    {
+        if constexpr (T::kNodeLevel == 0u)
+            return T::kLog2Side;
+        else
+            return (_level == T::kNodeLevel) ? T::kLog2Side : NodeLog2Side_<typename T::ChildT>(_level);
+    }
+
+    ChangeJournal *Journal_() const
+    {
+#ifdef QVDB_ENABLE_JOURNAL
+        return journal_;
+#else
+        return nullptr;
+#endif
+    }
+
 private:
+    template <typename VDB>
+    friend class BakedTree;
+
+    template <typename VDB>
+    friend class ProximityQuery;
+
+    template <typename C, unsigned S>
+    friend class ConcurrentRootNode;
+
     RootMap_t root_map_{};
     Box_t bounds_{};
 
+#ifdef QVDB_ENABLE_JOURNAL
+    ChangeJournal *journal_ = nullptr;
+#endif
+
 private:
     template <typename T, unsigned Index, unsigned Search>
     struct NodeBaseOp
@@ -477,6 +1412,12 @@ private:
 private:
     CacheEntry node_cache_[kNodeLevel];
 
+    void InvalidateCache_()
+    {
+        for (unsigned i = 0u; i < kNodeLevel; ++i)
+            node_cache_[i] = CacheEntry{ Position_t{}, nullptr };
+    }
+
     enum eOpType {
         kGet,
         kSet,
@@ -608,6 +1549,7 @@ public:
     struct UnitTests
     {
         using VDB_t = RootNode<Child>;
+        using LeafT = typename VDB_t::LeafT;
 
         template <typename T>
         static void Fill_FirstLevelChild(T &_vdb)
@@ -706,32 +1648,530 @@ public:
                 return vdb.get({0, 0, 1});
             }
         }
-    };
-#endif // QVDB_BUILD_TESTS
-};
-
-template <unsigned Size>
-struct Bitset
-{
-    static_assert(((Size & 63u) == 0), "Size must be multiple of 64");
-    static constexpr std::size_t kArraySize = Size/64u;
-    static constexpr std::size_t kArrayOffset(std::size_t index) { return index / 64u; }
-    static constexpr std::size_t kQWordOffset(std::size_t index) { return index & 63u; }
 
-    void set() {
-        for (int i = 0; i < kArraySize; ++i)
-            storage[i] = ~0ull;
-    }
+        static bool ForEachLeaf_Count()
+        {
+            constexpr Integer_t kLeafSide = 1 << LeafT::kLog2Side;
+            VDB_t vdb{};
+            vdb.set({ 0, 0, 0 });
+            vdb.set({ 1, 0, 0 });
+            vdb.set({ kLeafSide, 0, 0 });
+            vdb.set({ 0, 0, -kLeafSide });
+            std::size_t leaf_count = 0u;
+            std::size_t voxel_count = 0u;
+            vdb.forEachLeaf([&](LeafT &_leaf, Position_t const&) {
+                ++leaf_count;
+                voxel_count += _leaf.activeBits().count();
+            });
+            return leaf_count == 3u && voxel_count == 4u;
+        }
+        static bool ForEachLeaf_Base()
+        {
+            VDB_t vdb{};
+            Position_t const p{ 37, -5, 1000 };
+            vdb.set(p);
+            bool result = false;
+            vdb.forEachLeaf([&](LeafT&, Position_t const &_base) {
+                result = (_base == NodeBase_<LeafT>(p));
+            });
+            return result;
+        }
+        static bool ForEachLeaf_ParallelCount()
+        {
+            VDB_t vdb{};
+            std::size_t expected = 0u;
+            for (Integer_t i = -300; i < 300; i += 7, ++expected)
+                vdb.set({ i, i * 3, -i });
+            std::size_t serial_count = 0u;
+            vdb.forEachLeaf([&](LeafT &_leaf, Position_t const&) {
+                serial_count += _leaf.activeBits().count();
+            });
+            WorkStealingPool pool{ 3u };
+            std::atomic<std::size_t> parallel_count{ 0u };
+            vdb.forEachLeaf(pool, [&](LeafT &_leaf, Position_t const&) {
+                parallel_count += _leaf.activeBits().count();
+            });
+            return serial_count == expected && parallel_count.load() == serial_count;
+        }
+        static bool ForEachNode_FirstLevelCount()
+        {
+            VDB_t vdb{};
+            vdb.set({ 0, 0, 0 });
+            vdb.set({ 0, 0, 1 << Child::kLog2Side });
+            vdb.reset({ 0, 1 << Child::kLog2Side, 0 });
+            std::size_t count = 0u;
+            vdb.template forEachNode<Child::kNodeLevel>([&](Child&, Position_t const&) { ++count; });
+            WorkStealingPool pool{ 2u };
+            std::atomic<std::size_t> parallel_count{ 0u };
+            vdb.template forEachNode<Child::kNodeLevel>(pool, [&](Child&, Position_t const&) { ++parallel_count; });
+            return count == 2u && parallel_count.load() == 2u;
+        }
 
-    void reset() {
-        for (int i = 0; i < kArraySize; ++i)
-            storage[i] = 0ull;
-    }
+        static Unsigned_t QuadArea_(Quad_t const &_quad)
+        {
+            Unsigned_t area = 1u;
+            for (unsigned a = 0u; a < 3u; ++a)
+                if (a != _quad.axis)
+                    area *= (Unsigned_t)std::abs(_quad.corners[2][a] - _quad.corners[0][a]);
+            return area;
+        }
 
-    void set(std::size_t _i, bool _v = true) {
-        std::size_t const arrayOffset = kArrayOffset(_i);
-        std::size_t const qwordOffset = kQWordOffset(_i);
-        std::uint64_t const input = storage[arrayOffset];
+        static bool ExtractSurface_SingleVoxel()
+        {
+            VDB_t vdb{};
+            vdb.set({ 3, -2, 7 });
+            std::vector<Quad_t> quads{};
+            ExtractSurface(vdb, quads);
+            bool result = (quads.size() == 6u);
+            for (Quad_t const &quad : quads)
+            {
+                Integer_t const plane = quad.corners[0][quad.axis];
+                Position_t const p{ 3, -2, 7 };
+                result = result && QuadArea_(quad) == 1u &&
+                    plane == p[quad.axis] + (quad.positive ? 1 : 0);
+            }
+            return result;
+        }
+        static bool ExtractSurface_GreedyMerge()
+        {
+            constexpr Integer_t kLeafSide = 1 << LeafT::kLog2Side;
+            VDB_t vdb{};
+            for (Integer_t i = 0; i < kLeafSide; ++i)
+                vdb.set({ i, 0, 0 });
+            std::vector<Quad_t> quads{};
+            ExtractSurface(vdb, quads);
+            return quads.size() == 6u;
+        }
+        static bool ExtractSurface_AcrossLeaves()
+        {
+            constexpr Integer_t kLeafSide = 1 << LeafT::kLog2Side;
+            VDB_t vdb{};
+            vdb.set({ kLeafSide - 1, 0, 0 });
+            vdb.set({ kLeafSide, 0, 0 });
+            std::vector<Quad_t> quads{};
+            ExtractSurface(vdb, quads);
+            Unsigned_t area = 0u;
+            for (Quad_t const &quad : quads)
+                area += QuadArea_(quad);
+            return area == 10u;
+        }
+        static bool ExtractSurface_ParallelDeterministic()
+        {
+            VDB_t vdb{};
+            for (Integer_t i = -100; i < 100; i += 3)
+                for (Integer_t j = 0; j < 9; ++j)
+                    vdb.set({ i, j, (i * j) % 17 });
+            std::vector<Quad_t> serial{};
+            ExtractSurface(vdb, serial);
+            WorkStealingPool pool{ 3u };
+            std::vector<Quad_t> parallel{};
+            ExtractSurface(pool, vdb, parallel);
+            bool result = !serial.empty() && serial.size() == parallel.size();
+            for (std::size_t i = 0u; i < serial.size() && result; ++i)
+                result = serial[i].corners == parallel[i].corners;
+            return result;
+        }
+        static bool ExtractSurface_Tile()
+        {
+            VDB_t vdb{};
+            vdb.setTile({ 0, 0, 0 }, Child::kNodeLevel, true);
+            std::vector<Quad_t> quads{};
+            ExtractSurface(vdb, quads);
+            constexpr Unsigned_t kChildSide = 1ull << Child::kLog2Side;
+            bool result = (quads.size() == 6u);
+            for (Quad_t const &quad : quads)
+                result = result && QuadArea_(quad) == kChildSide * kChildSide;
+            return result;
+        }
+
+        static bool SetTile_GetInside()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            VDB_t vdb{};
+            vdb.get({ 0, 0, 0 });
+            vdb.setTile({ 1, 1, 1 }, Child::kNodeLevel, true);
+            std::size_t leaf_count = 0u;
+            vdb.forEachLeaf([&](LeafT&, Position_t const&) { ++leaf_count; });
+            return vdb.get({ 0, 0, 0 }) && vdb.get({ kChildSide - 1, kChildSide - 1, 0 }) &&
+                !vdb.get({ kChildSide, 0, 0 }) && leaf_count == 0u;
+        }
+        static bool SetTile_LeafInBranch()
+        {
+            constexpr Integer_t kLeafSide = 1 << LeafT::kLog2Side;
+            VDB_t vdb{};
+            vdb.set({ 0, 0, 0 });
+            vdb.setTile({ kLeafSide, 0, 0 }, 0u, true);
+            vdb.setTile({ 0, 0, 0 }, 0u, false);
+            return vdb.get({ kLeafSide, 1, 1 }) && !vdb.get({ 0, 0, 0 }) && !vdb.get({ kLeafSide * 2, 0, 0 });
+        }
+
+        static bool LodPyramid_AnyOccupied()
+        {
+            VDB_t vdb{};
+            vdb.set({ 5, 5, 5 });
+            vdb.set({ -1, 0, 0 });
+            LodPyramid<VDB_t> pyramid{ vdb, 3u };
+            pyramid.build();
+            return pyramid.level(1).get({ 2, 2, 2 }) && !pyramid.level(1).get({ 3, 3, 3 }) &&
+                pyramid.level(2).get({ 1, 1, 1 }) && pyramid.level(3).get({ 0, 0, 0 }) &&
+                pyramid.level(1).get({ -1, 0, 0 }) && pyramid.level(3).get({ -1, 0, 0 });
+        }
+        static bool LodPyramid_Majority()
+        {
+            VDB_t vdb{};
+            vdb.set({ 0, 0, 0 });
+            vdb.set({ 1, 0, 0 });
+            vdb.set({ 0, 1, 0 });
+            LodPyramid<VDB_t> pyramid{ vdb, 1u, eLodRule::kMajority };
+            pyramid.build();
+            bool const before = pyramid.level(1).get({ 0, 0, 0 });
+            pyramid.set({ 1, 1, 1 });
+            pyramid.update();
+            return !before && pyramid.level(1).get({ 0, 0, 0 });
+        }
+        static bool LodPyramid_Incremental()
+        {
+            VDB_t vdb{};
+            LodPyramid<VDB_t> pyramid{ vdb, 2u };
+            pyramid.build();
+            pyramid.set({ 40, -7, 3 });
+            pyramid.update();
+            bool const set = pyramid.level(1).get({ 20, -4, 1 }) && pyramid.level(2).get({ 10, -2, 0 });
+            pyramid.set({ 40, -7, 3 }, false);
+            pyramid.update();
+            bool const reset = !pyramid.level(1).get({ 20, -4, 1 }) && !pyramid.level(2).get({ 10, -2, 0 });
+            return set && reset;
+        }
+        static bool LodPyramid_TilePropagation()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            VDB_t vdb{};
+            vdb.setTile({ 0, 0, 0 }, Child::kNodeLevel, true);
+            LodPyramid<VDB_t> pyramid{ vdb, 1u };
+            pyramid.build();
+            VDB_t &coarse = pyramid.level(1);
+            return coarse.get({ 0, 0, 0 }) && coarse.get({ kChildSide / 2 - 1, kChildSide / 2 - 1, 0 }) &&
+                !coarse.get({ kChildSide / 2, 0, 0 });
+        }
+
+#ifdef QVDB_ENABLE_JOURNAL
+        static bool Journal_RecordsLeaves()
+        {
+            constexpr Integer_t kLeafSide = 1 << LeafT::kLog2Side;
+            VDB_t vdb{};
+            ChangeJournal journal{};
+            vdb.set({ 0, 0, 0 });
+            vdb.setJournal(&journal);
+            vdb.set({ 0, 0, 1 });
+            vdb.set({ 1, 0, 0 });
+            vdb.reset({ -kLeafSide, 0, 0 });
+            bool const recorded = journal.leaves().size() == 2u;
+            journal.checkpoint();
+            return recorded && journal.empty();
+        }
+        static bool Journal_DeltaReplicates()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            VDB_t source{};
+            VDB_t replica{};
+            for (Integer_t i = 0; i < 50; i += 3)
+            {
+                source.set({ i, -i, i * 2 });
+                replica.set({ i, -i, i * 2 });
+            }
+
+            ChangeJournal journal{};
+            source.setJournal(&journal);
+            source.setTile({ 2 * kChildSide, 0, 0 }, Child::kNodeLevel, true);
+            source.reset({ 2 * kChildSide + 1, 1, 1 });
+            source.reset({ 3, -3, 6 });
+            source.set({ -20, 7, 7 });
+            replica.applyDelta(source.extractDelta(journal));
+            journal.checkpoint();
+
+            source.setTile({ 2 * kChildSide, 0, 0 }, Child::kNodeLevel, false);
+            source.set({ 2 * kChildSide + 2, 0, 0 });
+            replica.applyDelta(source.extractDelta(journal));
+
+            bool result = true;
+            for (Integer_t z = -kChildSide; z < 3 * kChildSide && result; z += 1)
+                for (Integer_t y = -kChildSide; y < kChildSide && result; y += 1)
+                    for (Integer_t x = -kChildSide; x < 3 * kChildSide && result; x += 1)
+                        result = source.get({ x, y, z }) == replica.get({ x, y, z });
+            return result;
+        }
+#endif // QVDB_ENABLE_JOURNAL
+
+        static bool Bake_GetMatches()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            VDB_t vdb{};
+            for (Integer_t i = -60; i < 60; i += 5)
+                vdb.set({ i, (i * 7) % 13, -i / 2 });
+            vdb.setTile({ kChildSide, kChildSide, 0 }, Child::kNodeLevel, true);
+            vdb.reset({ kChildSide + 1, kChildSide, 0 });
+            vdb.reset({ 500, 0, 0 });
+            BakedTree<VDB_t> const baked = vdb.bake();
+            bool result = baked.valid();
+            for (Integer_t z = -40; z < 20 && result; ++z)
+                for (Integer_t y = -10; y < 2 * kChildSide && result; ++y)
+                    for (Integer_t x = -70; x < 2 * kChildSide && result; ++x)
+                        result = vdb.get({ x, y, z }) == baked.get({ x, y, z });
+            return result;
+        }
+        static bool Bake_Relocatable()
+        {
+            VDB_t vdb{};
+            vdb.set({ 3, 4, 5 });
+            vdb.set({ -300, 4, 5 });
+            std::vector<std::uint64_t> copy{};
+            {
+                BakedTree<VDB_t> const baked = vdb.bake();
+                copy.assign(baked.data(), baked.data() + baked.wordCount());
+            }
+            BakedView<VDB_t> const view{ copy.data(), copy.size() };
+            BakedTree<VDB_t> const owned{ copy.data(), copy.size() };
+            return view.valid() && view.get({ 3, 4, 5 }) && view.get({ -300, 4, 5 }) && !view.get({ 3, 4, 6 }) &&
+                owned.valid() && owned.get({ -300, 4, 5 });
+        }
+        static bool Bake_ForEach()
+        {
+            VDB_t vdb{};
+            for (Integer_t i = -30; i < 30; i += 2)
+                vdb.set({ i, -i, i * 3 });
+            vdb.setTile({ 1000, 0, 0 }, 0u, true);
+            std::size_t voxel_count = 0u;
+            std::size_t leaf_count = 0u;
+            vdb.bake().view().forEachLeaf([&](std::uint64_t const *_words, Position_t const&) {
+                ++leaf_count;
+                for (std::size_t w = 0u; w < LeafT::Bits_t::kArraySize; ++w)
+                    voxel_count += Popcount_(_words[w]);
+            });
+            std::size_t expected_leaf_count = 0u;
+            vdb.forEachLeaf([&](LeafT&, Position_t const&) { ++expected_leaf_count; });
+            std::size_t tile_count = 0u;
+            vdb.bake().view().forEachActiveTile([&](Box_t const &_tile) {
+                tile_count += (_tile.base == NodeBase_<LeafT>({ 1000, 0, 0 }));
+            });
+            return voxel_count == 30u && leaf_count == expected_leaf_count && tile_count == 1u;
+        }
+        static bool Bake_Raycast()
+        {
+            VDB_t vdb{};
+            vdb.set({ 200, 0, 0 });
+            vdb.set({ -3, 50, 0 });
+            BakedTree<VDB_t> const baked = vdb.bake();
+            Position_t hit{};
+            double t = 0.0;
+            bool const hit_x = baked.view().raycast({ 0.5, 0.5, 0.5 }, { 1.0, 0.0, 0.0 }, 1000.0, &hit, &t);
+            bool const result_x = hit_x && hit == Position_t{ 200, 0, 0 } && std::abs(t - 199.5) < 1e-9;
+            bool const hit_diag = baked.view().raycast({ -2.5, 0.5, 0.5 }, { -0.01, 1.0, 0.0 }, 1000.0, &hit);
+            bool const result_diag = hit_diag && hit == Position_t{ -3, 50, 0 };
+            bool const miss = !baked.view().raycast({ 0.5, 0.5, 0.5 }, { 0.0, -1.0, 0.0 }, 1000.0);
+            return result_x && result_diag && miss;
+        }
+
+        static bool CompactChildren_RankOrder()
+        {
+            using Bits_t = typename LeafT::Bits_t;
+            Bits_t bits{};
+            CompactChildren<int, Bits_t::kArraySize * 64u> children{};
+            std::size_t const indices[] = { 200u, 3u, 64u, 255u, 0u, 130u };
+            for (std::size_t index : indices)
+            {
+                children.insert(bits, index, new int((int)index));
+                bits.set(index);
+            }
+            bits.set(64u, false);
+            children.erase(bits, 64u);
+
+            bool result = true;
+            bits.forEachSet([&](std::size_t _index) {
+                result = result && *children.at(bits, _index) == (int)_index;
+            });
+            return result && bits.count() == 5u;
+        }
+
+        static bool Concurrent_DisjointWriters()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            constexpr unsigned kThreadCount = 4u;
+            ConcurrentRootNode<Child> grid{};
+            std::vector<std::thread> threads{};
+            for (unsigned t = 0u; t < kThreadCount; ++t)
+                threads.emplace_back([&grid, t]() {
+                    typename ConcurrentRootNode<Child>::Writer writer{ grid };
+                    for (Integer_t i = 0; i < 2 * kChildSide; ++i)
+                        writer.set({ i, (Integer_t)t * 3 * kChildSide, i / 2 });
+                });
+            for (std::thread &thread : threads)
+                thread.join();
+
+            VDB_t vdb{};
+            grid.extract(vdb);
+            std::size_t count = 0u;
+            vdb.forEachLeaf([&](LeafT &_leaf, Position_t const&) { count += _leaf.activeBits().count(); });
+            return count == kThreadCount * 2u * kChildSide && vdb.get({ 5, 9 * kChildSide, 2 }) && !grid.get({ 5, 0, 2 });
+        }
+        static bool Concurrent_SharedEntry()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            constexpr unsigned kThreadCount = 4u;
+            ConcurrentRootNode<Child> grid{};
+            std::vector<std::thread> threads{};
+            for (unsigned t = 0u; t < kThreadCount; ++t)
+                threads.emplace_back([&grid, t]() {
+                    typename ConcurrentRootNode<Child>::Writer writer{ grid };
+                    for (Integer_t z = 0; z < kChildSide; ++z)
+                        for (Integer_t y = 0; y < kChildSide; ++y)
+                            for (Integer_t x = (Integer_t)t; x < kChildSide; x += kThreadCount)
+                                writer.set({ x, y, z }, (x + y + z) % 3 != 0);
+                });
+            for (std::thread &thread : threads)
+                thread.join();
+
+            bool result = true;
+            typename ConcurrentRootNode<Child>::Writer reader{ grid };
+            for (Integer_t z = 0; z < kChildSide && result; ++z)
+                for (Integer_t y = 0; y < kChildSide && result; ++y)
+                    for (Integer_t x = 0; x < kChildSide && result; ++x)
+                        result = reader.get({ x, y, z }) == ((x + y + z) % 3 != 0);
+            return result;
+        }
+        static bool Concurrent_WriterAfterExtract()
+        {
+            ConcurrentRootNode<Child> grid{};
+            typename ConcurrentRootNode<Child>::Writer writer{ grid };
+            writer.set({ 1, 2, 3 });
+            VDB_t first{};
+            grid.extract(first);
+            writer.set({ 1, 2, 4 });
+            bool const extracted = !writer.get({ 1, 2, 3 }) && writer.get({ 1, 2, 4 });
+            grid.clear();
+            writer.set({ 1, 2, 5 });
+            VDB_t second{};
+            grid.extract(second);
+            return extracted && first.get({ 1, 2, 3 }) && !first.get({ 1, 2, 4 }) &&
+                second.get({ 1, 2, 5 }) && !second.get({ 1, 2, 4 });
+        }
+
+        // Scattered voxels across several root entries, with the brute force answers
+        static std::vector<Position_t> ProximityScene_(VDB_t &_vdb)
+        {
+            std::vector<Position_t> voxels{};
+            for (Integer_t i = 0; i < 40; ++i)
+                voxels.push_back({ (i * 37) % 61 - 30, (i * 11) % 23 - 11, (i * 53) % 47 - 23 });
+            for (Position_t const &voxel : voxels)
+                _vdb.set(voxel);
+            return voxels;
+        }
+        static double Distance_(Position_t const &_lhs, Position_t const &_rhs)
+        {
+            double const dx = (double)(_lhs[0] - _rhs[0]);
+            double const dy = (double)(_lhs[1] - _rhs[1]);
+            double const dz = (double)(_lhs[2] - _rhs[2]);
+            return std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+        static bool NearestActive_MatchesBruteForce()
+        {
+            VDB_t vdb{};
+            std::vector<Position_t> const voxels = ProximityScene_(vdb);
+            bool result = true;
+            for (Integer_t q = 0; q < 64 && result; ++q)
+            {
+                Position_t const p{ (q * 29) % 71 - 35, (q * 13) % 31 - 15, (q * 7) % 43 - 21 };
+                double expected = std::numeric_limits<double>::max();
+                for (Position_t const &voxel : voxels)
+                    expected = std::min(expected, Distance_(p, voxel));
+                NearestResult_t const nearest = vdb.nearestActive(p, 100.0);
+                result = nearest.found && vdb.get(nearest.position) &&
+                    nearest.distance == expected && Distance_(p, nearest.position) == expected;
+            }
+            return result && !vdb.nearestActive({ 500, 500, 500 }, 10.0).found;
+        }
+        static bool NearestActive_Tile()
+        {
+            constexpr Integer_t kChildSide = 1 << Child::kLog2Side;
+            VDB_t vdb{};
+            vdb.setTile({ 0, 0, 0 }, Child::kNodeLevel, true);
+            vdb.set({ -3 * kChildSide, 0, 0 });
+            NearestResult_t const nearest = vdb.nearestActive({ kChildSide + 2, 1, -4 }, 10.0);
+            Position_t const expected{ kChildSide - 1, 1, 0 };
+            return nearest.found && nearest.position == expected && nearest.distance == 5.0 &&
+                !vdb.nearestActive({ kChildSide + 2, 1, -4 }, 4.9).found;
+        }
+        static bool ActiveWithinRadius_MatchesBruteForce()
+        {
+            constexpr Integer_t kLeafSide = 1 << LeafT::kLog2Side;
+            VDB_t vdb{};
+            std::vector<Position_t> voxels = ProximityScene_(vdb);
+            vdb.setTile({ 2 * kLeafSide, 0, 0 }, 0u, true);
+            std::sort(voxels.begin(), voxels.end(), PositionLess_);
+            voxels.erase(std::unique(voxels.begin(), voxels.end()), voxels.end());
+
+            Position_t const p{ kLeafSide, 1, 2 };
+            constexpr double kRadius = 13.5;
+            std::vector<Position_t> expected{};
+            for (Integer_t z = p[2] - 14; z <= p[2] + 14; ++z)
+                for (Integer_t y = p[1] - 14; y <= p[1] + 14; ++y)
+                    for (Integer_t x = p[0] - 14; x <= p[0] + 14; ++x)
+                        if (vdb.get({ x, y, z }) && Distance_(p, { x, y, z }) <= kRadius)
+                            expected.push_back({ x, y, z });
+            std::sort(expected.begin(), expected.end(), PositionLess_);
+
+            std::vector<Position_t> found{};
+            vdb.activeWithinRadius(p, kRadius, found);
+            return found == expected && found.size() > voxels.size() / 4u;
+        }
+        static bool NearestActive_Batched()
+        {
+            VDB_t vdb{};
+            ProximityScene_(vdb);
+            std::vector<Position_t> points{};
+            for (Integer_t q = 0; q < 300; ++q)
+                points.push_back({ (q * 17) % 83 - 41, (q * 5) % 29 - 14, (q * 3) % 37 - 18 });
+
+            std::vector<NearestResult_t> serial{}, parallel{};
+            vdb.nearestActive(points, 8.0, serial);
+            WorkStealingPool pool{ 3u };
+            vdb.nearestActive(pool, points, 8.0, parallel);
+
+            bool result = serial.size() == points.size() && parallel.size() == points.size();
+            for (std::size_t i = 0u; i < points.size() && result; ++i)
+            {
+                NearestResult_t const single = vdb.nearestActive(points[i], 8.0);
+                result = serial[i].found == single.found && parallel[i].found == single.found &&
+                    (!single.found || (serial[i].position == single.position &&
+                                       parallel[i].position == single.position));
+            }
+            return result;
+        }
+    };
+#endif // QVDB_BUILD_TESTS
+};
+
+template <unsigned Size>
+struct Bitset
+{
+    static_assert(((Size & 63u) == 0), "Size must be multiple of 64");
+    static constexpr std::size_t kArraySize = Size/64u;
+    static constexpr std::size_t kArrayOffset(std::size_t index) { return index / 64u; }
+    static constexpr std::size_t kQWordOffset(std::size_t index) { return index & 63u; }
+
+    void set() {
+        for (int i = 0; i < kArraySize; ++i)
+            storage[i] = ~0ull;
+    }
+
+    void reset() {
+        for (int i = 0; i < kArraySize; ++i)
+            storage[i] = 0ull;
+    }
+
+    void set(std::size_t _i, bool _v = true) {
+        std::size_t const arrayOffset = kArrayOffset(_i);
+        std::size_t const qwordOffset = kQWordOffset(_i);
+        std::uint64_t const input = storage[arrayOffset];
 
         std::uint64_t const output = _v
             ? (input | (1ull << qwordOffset))
@@ -761,7 +2201,1635 @@ struct Bitset
         return none;
     }
 
+    std::size_t count() const {
+        std::size_t count = 0u;
+        for (std::size_t i = 0u; i < kArraySize; ++i)
+            count += Popcount_(storage[i]);
+        return count;
+    }
+
+    // Calls _f(index) for every set bit, in increasing order
+    template <typename F>
+    void forEachSet(F &&_f) const {
+        for (std::size_t i = 0; i < kArraySize; ++i)
+            for (std::uint64_t word = storage[i]; word != 0ull; word &= word - 1ull)
+                _f(i * 64u + Ctz_(word));
+    }
+
+    Bitset operator~() const {
+        Bitset result;
+        for (std::size_t i = 0; i < kArraySize; ++i)
+            result.storage[i] = ~storage[i];
+        return result;
+    }
+
+    Bitset operator&(Bitset const &_rhs) const {
+        Bitset result;
+        for (std::size_t i = 0; i < kArraySize; ++i)
+            result.storage[i] = storage[i] & _rhs.storage[i];
+        return result;
+    }
+
+    Bitset operator|(Bitset const &_rhs) const {
+        Bitset result;
+        for (std::size_t i = 0; i < kArraySize; ++i)
+            result.storage[i] = storage[i] | _rhs.storage[i];
+        return result;
+    }
+
+    // Same semantic as std::bitset, bit i of the result is bit i+_k of the input
+    Bitset operator>>(std::size_t _k) const {
+        Bitset result;
+        std::size_t const word_shift = _k / 64u;
+        std::size_t const bit_shift = _k & 63u;
+        for (std::size_t i = 0; i + word_shift < kArraySize; ++i)
+        {
+            std::size_t const src = i + word_shift;
+            result.storage[i] = storage[src] >> bit_shift;
+            if (bit_shift != 0u && src + 1u < kArraySize)
+                result.storage[i] |= storage[src + 1u] << (64u - bit_shift);
+        }
+        return result;
+    }
+
+    // Bit i+_k of the result is bit i of the input
+    Bitset operator<<(std::size_t _k) const {
+        Bitset result;
+        std::size_t const word_shift = _k / 64u;
+        std::size_t const bit_shift = _k & 63u;
+        for (std::size_t i = word_shift; i < kArraySize; ++i)
+        {
+            std::size_t const src = i - word_shift;
+            result.storage[i] = storage[src] << bit_shift;
+            if (bit_shift != 0u && src > 0u)
+                result.storage[i] |= storage[src - 1u] >> (64u - bit_shift);
+        }
+        return result;
+    }
+
     std::uint64_t storage[kArraySize]{};
 };
 
+// =============================================================================
+// SURFACE EXTRACTION
+// =============================================================================
+
+inline void QuadsToTriangles(std::vector<Quad_t> const &_quads, std::vector<Triangle_t> &_out)
+{
+    _out.reserve(_out.size() + _quads.size() * 2u);
+    for (Quad_t const &quad : _quads)
+    {
+        _out.push_back(Triangle_t{ quad.corners[0], quad.corners[1], quad.corners[2] });
+        _out.push_back(Triangle_t{ quad.corners[0], quad.corners[2], quad.corners[3] });
+    }
+}
+
+// Merges the set cells of a _width x _height mask into rectangles, clearing the mask
+// and calling _f(u, v, w, h) for each of them.
+template <typename F>
+static void GreedyMerge_(std::vector<std::uint8_t> &_mask, Unsigned_t _width, Unsigned_t _height, F &&_f)
+{
+    for (Unsigned_t v = 0u; v < _height; ++v)
+    {
+        for (Unsigned_t u = 0u; u < _width;)
+        {
+            if (!_mask[v * _width + u])
+            {
+                ++u;
+                continue;
+            }
+
+            Unsigned_t w = 1u;
+            while (u + w < _width && _mask[v * _width + u + w])
+                ++w;
+
+            Unsigned_t h = 1u;
+            for (bool grow = true; grow && v + h < _height;)
+            {
+                for (Unsigned_t k = 0u; k < w && grow; ++k)
+                    grow = _mask[(v + h) * _width + u + k];
+                if (grow)
+                    ++h;
+            }
+
+            for (Unsigned_t j = 0u; j < h; ++j)
+                for (Unsigned_t k = 0u; k < w; ++k)
+                    _mask[(v + j) * _width + u + k] = 0u;
+
+            _f(u, v, w, h);
+            u += w;
+        }
+    }
+}
+
+// _origin is the world position of mask cell (0, 0) on the face plane
+static void EmitQuad_(unsigned _axis, bool _positive, Position_t const &_origin,
+                      Unsigned_t _u, Unsigned_t _v, Unsigned_t _w, Unsigned_t _h,
+                      std::vector<Quad_t> &_out)
+{
+    unsigned const u_axis = (_axis + 1u) % 3u;
+    unsigned const v_axis = (_axis + 2u) % 3u;
+
+    Position_t c0 = _origin;
+    c0[u_axis] += (Integer_t)_u;
+    c0[v_axis] += (Integer_t)_v;
+    Position_t c1 = c0;
+    c1[u_axis] += (Integer_t)_w;
+    Position_t c2 = c1;
+    c2[v_axis] += (Integer_t)_h;
+    Position_t c3 = c0;
+    c3[v_axis] += (Integer_t)_h;
+
+    // (u, v, axis) is right handed, (c0, c1, c2, c3) is counter clockwise seen from +axis
+    if (_positive)
+        _out.push_back(Quad_t{ { c0, c1, c2, c3 }, _axis, true });
+    else
+        _out.push_back(Quad_t{ { c0, c3, c2, c1 }, _axis, false });
+}
+
+// Returns the occupancy of the leaf sized region at _leaf_base, whatever its storage.
+template <typename VDB>
+static typename VDB::LeafT::Bits_t LeafPatch_(VDB &_vdb, Position_t const &_leaf_base)
+{
+    static_assert(HasWordStorage_<typename VDB::LeafT::Bits_t>::value, "Leaf patches " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+    typename VDB::LeafT::Bits_t bits{};
+    std::size_t size = 0u;
+    std::uint64_t const *data = nullptr;
+    _vdb.GetLeafPointer(_leaf_base, &size, &data);
+    if (size == 0u)
+    {
+        if (data != nullptr)
+            bits.set();
+    }
+    else if (size != -1ull)
+    {
+        for (std::size_t i = 0u; i < size; ++i)
+            bits.storage[i] = data[i];
+    }
+    return bits;
+}
+
+template <typename Bits_t, std::size_t Log2Side>
+struct LeafFaceMasks_
+{
+    static constexpr Unsigned_t kSide = 1ull << Log2Side;
+
+    // lo[a] holds the voxels with a local coordinate of 0 along axis a, hi[a] kSide-1
+    LeafFaceMasks_()
+    {
+        for (Unsigned_t z = 0u; z < kSide; ++z)
+            for (Unsigned_t y = 0u; y < kSide; ++y)
+                for (Unsigned_t x = 0u; x < kSide; ++x)
+                {
+                    std::size_t const index = x | (y << Log2Side) | (z << Log2Side*2u);
+                    Unsigned_t const c[3] = { x, y, z };
+                    for (unsigned a = 0u; a < 3u; ++a)
+                    {
+                        if (c[a] == 0u) lo[a].set(index);
+                        if (c[a] == kSide - 1u) hi[a].set(index);
+                    }
+                }
+    }
+
+    Bits_t lo[3];
+    Bits_t hi[3];
+};
+
+template <typename VDB>
+static void LeafSurface_(VDB &_vdb, Position_t const &_base,
+                         typename VDB::LeafT::Bits_t const &_bits,
+                         std::vector<Quad_t> &_out)
+{
+    using Bits_t = typename VDB::LeafT::Bits_t;
+    static_assert(HasWordStorage_<Bits_t>::value, "Surface extraction " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+    constexpr std::size_t kLog2Side = VDB::LeafT::kLog2Side;
+    constexpr Unsigned_t kSide = 1ull << kLog2Side;
+    static LeafFaceMasks_<Bits_t, kLog2Side> const masks{};
+
+    std::vector<std::uint8_t> mask(kSide * kSide);
+    for (unsigned axis = 0u; axis < 3u; ++axis)
+    {
+        std::size_t const stride = std::size_t(1u) << (kLog2Side * axis);
+        std::size_t const across = stride * (kSide - 1u);
+        unsigned const u_axis = (axis + 1u) % 3u;
+        unsigned const v_axis = (axis + 2u) % 3u;
+
+        for (int sign = 0; sign < 2; ++sign)
+        {
+            bool const positive = (sign == 0);
+            Position_t neighbour_base = _base;
+            neighbour_base[axis] += positive ? (Integer_t)kSide : -(Integer_t)kSide;
+            Bits_t const neighbour = LeafPatch_(_vdb, neighbour_base);
+
+            // Occupancy of the voxel next to each voxel, in the face direction.
+            // Shifting moves the inner neighbours in place, the boundary layer
+            // comes from the opposite layer of the adjacent leaf.
+            Bits_t const next = positive
+                ? ((_bits >> stride) & ~masks.hi[axis]) | ((neighbour << across) & masks.hi[axis])
+                : ((_bits << stride) & ~masks.lo[axis]) | ((neighbour >> across) & masks.lo[axis]);
+            Bits_t const faces = _bits & ~next;
+            if (faces.none())
+                continue;
+
+            for (Unsigned_t c = 0u; c < kSide; ++c)
+            {
+                bool any = false;
+                for (Unsigned_t v = 0u; v < kSide; ++v)
+                    for (Unsigned_t u = 0u; u < kSide; ++u)
+                    {
+                        std::size_t const index =
+                            (c << (kLog2Side * axis)) |
+                            (u << (kLog2Side * u_axis)) |
+                            (v << (kLog2Side * v_axis));
+                        bool const face = faces.test(index);
+                        mask[v * kSide + u] = face;
+                        any |= face;
+                    }
+
+                if (!any)
+                    continue;
+
+                Position_t origin = _base;
+                origin[axis] += (Integer_t)c + (positive ? 1 : 0);
+                GreedyMerge_(mask, kSide, kSide, [&](Unsigned_t _u, Unsigned_t _v, Unsigned_t _w, Unsigned_t _h) {
+                    EmitQuad_(axis, positive, origin, _u, _v, _w, _h, _out);
+                });
+            }
+        }
+    }
+}
+
+// Tile faces are built from the adjacent layer, one leaf sized patch at a time,
+// and merged over the whole face. A tile next to inactive space yields one quad per face.
+template <typename VDB>
+static void TileSurface_(VDB &_vdb, Box_t const &_tile, std::vector<Quad_t> &_out)
+{
+    using Bits_t = typename VDB::LeafT::Bits_t;
+    constexpr std::size_t kLog2Side = VDB::LeafT::kLog2Side;
+    constexpr Unsigned_t kLeafSide = 1ull << kLog2Side;
+    Unsigned_t const side = _tile.extent[0];
+
+    std::vector<std::uint8_t> mask(side * side);
+    for (unsigned axis = 0u; axis < 3u; ++axis)
+    {
+        unsigned const u_axis = (axis + 1u) % 3u;
+        unsigned const v_axis = (axis + 2u) % 3u;
+
+        for (int sign = 0; sign < 2; ++sign)
+        {
+            bool const positive = (sign == 0);
+            Unsigned_t const layer = positive ? 0u : kLeafSide - 1u;
+
+            Position_t patch_base = _tile.base;
+            patch_base[axis] += positive ? (Integer_t)side : -(Integer_t)kLeafSide;
+
+            bool any = false;
+            for (Unsigned_t pv = 0u; pv < side; pv += kLeafSide)
+                for (Unsigned_t pu = 0u; pu < side; pu += kLeafSide)
+                {
+                    Position_t leaf_base = patch_base;
+                    leaf_base[u_axis] += (Integer_t)pu;
+                    leaf_base[v_axis] += (Integer_t)pv;
+                    Bits_t const neighbour = LeafPatch_(_vdb, leaf_base);
+
+                    for (Unsigned_t v = 0u; v < kLeafSide; ++v)
+                        for (Unsigned_t u = 0u; u < kLeafSide; ++u)
+                        {
+                            std::size_t const index =
+                                (layer << (kLog2Side * axis)) |
+                                (u << (kLog2Side * u_axis)) |
+                                (v << (kLog2Side * v_axis));
+                            bool const face = !neighbour.test(index);
+                            mask[(pv + v) * side + pu + u] = face;
+                            any |= face;
+                        }
+                }
+
+            if (!any)
+                continue;
+
+            Position_t origin = _tile.base;
+            if (positive)
+                origin[axis] += (Integer_t)side;
+            GreedyMerge_(mask, side, side, [&](Unsigned_t _u, Unsigned_t _v, Unsigned_t _w, Unsigned_t _h) {
+                EmitQuad_(axis, positive, origin, _u, _v, _w, _h, _out);
+            });
+        }
+    }
+}
+
+template <typename VDB>
+static void ExtractSurface_(VDB &_vdb, WorkStealingPool *_pool, std::vector<Quad_t> &_out)
+{
+    using LeafT = typename VDB::LeafT;
+
+    std::vector<std::pair<Position_t, LeafT const*>> leaves{};
+    _vdb.forEachLeaf([&](LeafT &_leaf, Position_t const &_base) {
+        leaves.emplace_back(_base, &_leaf);
+    });
+    std::vector<Box_t> tiles{};
+    _vdb.forEachActiveTile([&](Box_t const &_tile) {
+        tiles.push_back(_tile);
+    });
+
+    // Sorting by base makes the output independent of the root map layout
+    std::sort(leaves.begin(), leaves.end(), [](auto const &_lhs, auto const &_rhs) {
+        return PositionLess_(_lhs.first, _rhs.first);
+    });
+    std::sort(tiles.begin(), tiles.end(), [](Box_t const &_lhs, Box_t const &_rhs) {
+        return PositionLess_(_lhs.base, _rhs.base);
+    });
+
+    std::vector<std::vector<Quad_t>> results(leaves.size() + tiles.size());
+    auto process = [&](std::size_t _i) {
+        if (_i < leaves.size())
+            LeafSurface_(_vdb, leaves[_i].first, leaves[_i].second->activeBits(), results[_i]);
+        else
+            TileSurface_(_vdb, tiles[_i - leaves.size()], results[_i]);
+    };
+
+    if (_pool != nullptr)
+    {
+        for (std::size_t i = 0u; i < results.size(); ++i)
+            _pool->push([&process, i]() { process(i); });
+        _pool->wait();
+    }
+    else
+    {
+        for (std::size_t i = 0u; i < results.size(); ++i)
+            process(i);
+    }
+
+    for (std::vector<Quad_t> const &result : results)
+        _out.insert(_out.end(), result.begin(), result.end());
+}
+
+// Appends to _out the quads enclosing every active voxel of _vdb.
+// Coplanar faces are merged greedily within each leaf, active tiles emit merged
+// quads per face. The output order only depends on the grid content.
+template <typename VDB>
+void ExtractSurface(VDB &_vdb, std::vector<Quad_t> &_out)
+{
+    ExtractSurface_(_vdb, nullptr, _out);
+}
+
+template <typename VDB>
+void ExtractSurface(WorkStealingPool &_pool, VDB &_vdb, std::vector<Quad_t> &_out)
+{
+    ExtractSurface_(_vdb, &_pool, _out);
+}
+
+// =============================================================================
+// LEVELS OF DETAIL
+// =============================================================================
+
+// Chain of grids downsampled by 2 from a base grid, level i having voxels of side 2^i.
+// Coarse leaves are computed by reducing the 2x2x2 blocks of the 8 fine leaves they cover,
+// tiles twice a leaf wide or more are propagated as tiles.
+// Writes going through set() or reported with markDirty() are propagated by update().
+template <typename VDB>
+class LodPyramid
+{
+public:
+    using LeafT = typename VDB::LeafT;
+    using Bits_t = typename LeafT::Bits_t;
+    static_assert(HasWordStorage_<Bits_t>::value, "LodPyramid " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+    static constexpr std::size_t kLog2Side = LeafT::kLog2Side;
+    static constexpr Integer_t kLeafSide = Integer_t(1) << kLog2Side;
+
+    LodPyramid(VDB &_base, unsigned _level_count, eLodRule _rule = eLodRule::kAnyOccupied)
+        : base_{ _base }, rule_{ _rule }
+    {
+        levels_.reserve(_level_count);
+        for (unsigned i = 0u; i < _level_count; ++i)
+            levels_.emplace_back(new VDB{});
+    }
+
+    unsigned levelCount() const { return (unsigned)levels_.size(); }
+
+    // Level 0 is the base grid
+    VDB &level(unsigned _level)
+    {
+        return (_level == 0u) ? base_ : *levels_[_level - 1u];
+    }
+
+    void build()
+    {
+        dirty_.clear();
+        for (unsigned i = 1u; i <= levelCount(); ++i)
+        {
+            VDB &fine = level(i - 1u);
+            VDB &coarse = level(i);
+            coarse.clear();
+
+            std::unordered_set<Position_t, PositionHash> dirty{};
+            fine.forEachLeaf([&](LeafT&, Position_t const &_base) {
+                dirty.insert(CoarseLeafBase_(_base));
+            });
+            fine.forEachActiveTile([&](Box_t const &_tile) {
+                if ((Integer_t)_tile.extent[0] < 2 * kLeafSide)
+                    dirty.insert(CoarseLeafBase_(_tile.base));
+                else
+                    PropagateTile_(coarse, _tile);
+            });
+
+            for (Position_t const &coarse_base : dirty)
+                UpdateLeaf_(fine, coarse, coarse_base);
+        }
+    }
+
+    void set(Position_t const &_p, bool const _v = true)
+    {
+        base_.set(_p, _v);
+        markDirty(_p);
+    }
+
+    void markDirty(Position_t const &_p)
+    {
+        dirty_.insert(NodeBase_<LeafT>(_p));
+    }
+
+    // Recomputes the coarse leaves covering the regions marked dirty since the last update
+    void update()
+    {
+        std::unordered_set<Position_t, PositionHash> dirty = std::move(dirty_);
+        dirty_.clear();
+        for (unsigned i = 1u; i <= levelCount() && !dirty.empty(); ++i)
+        {
+            std::unordered_set<Position_t, PositionHash> next{};
+            for (Position_t const &fine_base : dirty)
+                next.insert(CoarseLeafBase_(fine_base));
+
+            for (Position_t const &coarse_base : next)
+                UpdateLeaf_(level(i - 1u), level(i), coarse_base);
+            dirty = std::move(next);
+        }
+    }
+
+private:
+    static Position_t CoarsePosition_(Position_t const &_p)
+    {
+        return { _p[0] >> 1, _p[1] >> 1, _p[2] >> 1 };
+    }
+
+    static Position_t CoarseLeafBase_(Position_t const &_fine)
+    {
+        return NodeBase_<LeafT>(CoarsePosition_(_fine));
+    }
+
+    // Covers the coarse image of a fine tile with the largest node tiles that fit
+    static void PropagateTile_(VDB &_coarse, Box_t const &_tile)
+    {
+        Unsigned_t const side = _tile.extent[0] >> 1u;
+        unsigned level = 0u;
+        while (level + 1u < VDB::kNodeLevel && (1ull << VDB::NodeLog2Side(level + 1u)) <= side)
+            ++level;
+
+        Integer_t const step = Integer_t(1) << VDB::NodeLog2Side(level);
+        Position_t const base = CoarsePosition_(_tile.base);
+        for (Integer_t z = 0; z < (Integer_t)side; z += step)
+            for (Integer_t y = 0; y < (Integer_t)side; y += step)
+                for (Integer_t x = 0; x < (Integer_t)side; x += step)
+                    _coarse.setTile({ base[0] + x, base[1] + y, base[2] + z }, level, true);
+    }
+
+    void UpdateLeaf_(VDB &_fine, VDB &_coarse, Position_t const &_coarse_base) const
+    {
+        constexpr std::size_t kHalfSide = std::size_t(1) << (kLog2Side - 1u);
+        constexpr std::size_t kStrideY = std::size_t(1) << kLog2Side;
+        constexpr std::size_t kStrideZ = std::size_t(1) << (kLog2Side * 2u);
+
+        Bits_t coarse{};
+        for (std::size_t octant = 0u; octant < 8u; ++octant)
+        {
+            std::size_t const o[3] = { octant & 1u, (octant >> 1u) & 1u, (octant >> 2u) & 1u };
+            Position_t const fine_base{
+                _coarse_base[0] * 2 + (Integer_t)o[0] * kLeafSide,
+                _coarse_base[1] * 2 + (Integer_t)o[1] * kLeafSide,
+                _coarse_base[2] * 2 + (Integer_t)o[2] * kLeafSide
+            };
+            Bits_t const fine = LeafPatch_(_fine, fine_base);
+            if (fine.none())
+                continue;
+
+            // Fold each 2x2x2 block onto its lowest voxel, one axis at a time
+            Bits_t reduced = fine;
+            if (rule_ == eLodRule::kAnyOccupied)
+            {
+                reduced = reduced | (reduced >> 1u);
+                reduced = reduced | (reduced >> kStrideY);
+                reduced = reduced | (reduced >> kStrideZ);
+            }
+
+            for (std::size_t z = 0u; z < kHalfSide; ++z)
+                for (std::size_t y = 0u; y < kHalfSide; ++y)
+                    for (std::size_t x = 0u; x < kHalfSide; ++x)
+                    {
+                        std::size_t const fine_index = (x * 2u) | (y * 2u) * kStrideY | (z * 2u) * kStrideZ;
+                        bool active = false;
+                        if (rule_ == eLodRule::kAnyOccupied)
+                            active = reduced.test(fine_index);
+                        else
+                        {
+                            unsigned count = 0u;
+                            for (std::size_t k = 0u; k < 8u; ++k)
+                                count += fine.test(fine_index + (k & 1u) + ((k >> 1u) & 1u) * kStrideY + (k >> 2u) * kStrideZ);
+                            active = (count >= 4u);
+                        }
+
+                        if (active)
+                        {
+                            std::size_t const coarse_index =
+                                (x + o[0] * kHalfSide) |
+                                (y + o[1] * kHalfSide) * kStrideY |
+                                (z + o[2] * kHalfSide) * kStrideZ;
+                            coarse.set(coarse_index);
+                        }
+                    }
+        }
+
+        _coarse.setLeaf(_coarse_base, coarse);
+    }
+
+private:
+    VDB &base_;
+    eLodRule rule_;
+    std::vector<std::unique_ptr<VDB>> levels_{};
+    std::unordered_set<Position_t, PositionHash> dirty_{}; // leaf bases in the base grid
+};
+
+// =============================================================================
+// BAKED TREE
+// =============================================================================
+
+// Read only view over a baked tree buffer. The buffer only holds offsets, it can be
+// copied, written to disk or mapped in another process as long as VDB matches.
+//
+// Layout, in 64 bits words :
+//   header      magic, layout signature, root entry count, word count
+//   root table  x, y, z, payload per entry, sorted on z, y, x
+//               payload is (offset << 2) | (active << 1) | has_child
+//   nodes       breadth first, the children of a node are contiguous and ordered
+//               like its child bits
+//   branch      child bits, active bits, then 32 bits integers packed two per word:
+//               child rank at the start of each bit word, followed by the offset of
+//               the first child. Child i lives at first + rank(i) * child size.
+//   leaf        active bits
+template <typename VDB>
+class BakedView
+{
+public:
+    using LeafT = typename VDB::LeafT;
+    static constexpr std::uint64_t kMagic = 0x454b414242445651ull; // "QVDBBAKE"
+    static constexpr std::size_t kHeaderWords = 4u;
+    static constexpr std::size_t kRootEntryWords = 4u;
+
+    BakedView() = default;
+    BakedView(std::uint64_t const *_data, std::size_t _word_count)
+        : data_{ _data }, word_count_{ _word_count }
+    {}
+
+    static constexpr std::uint64_t Signature()
+    {
+        std::uint64_t signature = VDB::kNodeLevel;
+        for (unsigned level = 0u; level < VDB::kNodeLevel; ++level)
+            signature = (signature << 6u) | VDB::NodeLog2Side(level);
+        return signature;
+    }
+
+    bool valid() const
+    {
+        return data_ != nullptr && word_count_ >= kHeaderWords &&
+            data_[0] == kMagic && data_[1] == Signature() && data_[3] == word_count_;
+    }
+
+    std::uint64_t const *data() const { return data_; }
+    std::size_t wordCount() const { return word_count_; }
+    std::size_t rootCount() const { return (std::size_t)data_[2]; }
+
+    bool get(Position_t const &_p) const
+    {
+        bool active = false;
+        unsigned log2_side = 0u;
+        Probe_(_p, &active, &log2_side);
+        return active;
+    }
+
+    // Calls _f(std::uint64_t const* words, Position_t const& base) for every leaf, in the
+    // argument order of RootNode::forEachLeaf
+    template <typename F>
+    void forEachLeaf(F &&_f) const
+    {
+        for (std::size_t i = 0u; i < rootCount(); ++i)
+        {
+            std::uint64_t const *entry = RootEntry_(i);
+            if (entry[3] & 1ull)
+                ForEachLeaf_<typename VDB::ChildT>(entry[3] >> 2u, RootEntryBase_(entry), _f);
+        }
+    }
+
+    // Calls _f(Box_t const&) for every active tile
+    template <typename F>
+    void forEachActiveTile(F &&_f) const
+    {
+        using Child = typename VDB::ChildT;
+        constexpr Unsigned_t kTileSide = 1ull << Child::kLog2Side;
+        for (std::size_t i = 0u; i < rootCount(); ++i)
+        {
+            std::uint64_t const *entry = RootEntry_(i);
+            if (entry[3] & 1ull)
+                ForEachActiveTile_<Child>(entry[3] >> 2u, RootEntryBase_(entry), _f);
+            else if (entry[3] & 2ull)
+                _f(Box_t{ RootEntryBase_(entry), Extent_t{ kTileSide, kTileSide, kTileSide } });
+        }
+    }
+
+    // Walks the ray _origin + t * _direction for t in [0, _max_t], skipping uniform
+    // inactive regions whole. Returns the first active voxel crossed.
+    bool raycast(std::array<double, 3u> const &_origin, std::array<double, 3u> const &_direction,
+                 double _max_t, Position_t *_hit = nullptr, double *_hit_t = nullptr) const
+    {
+        Position_t p{
+            (Integer_t)std::floor(_origin[0]),
+            (Integer_t)std::floor(_origin[1]),
+            (Integer_t)std::floor(_origin[2])
+        };
+
+        double t = 0.0;
+        while (t <= _max_t)
+        {
+            bool active = false;
+            unsigned log2_side = 0u;
+            Probe_(p, &active, &log2_side);
+            if (active)
+            {
+                if (_hit) *_hit = p;
+                if (_hit_t) *_hit_t = t;
+                return true;
+            }
+
+            // Leave the uniform region containing p
+            Integer_t const mask = (Integer_t(1) << log2_side) - 1;
+            Position_t const lower{ p[0] & ~mask, p[1] & ~mask, p[2] & ~mask };
+
+            double exit_t = std::numeric_limits<double>::infinity();
+            unsigned exit_axis = 0u;
+            for (unsigned a = 0u; a < 3u; ++a)
+            {
+                if (_direction[a] == 0.0)
+                    continue;
+                double const bound = (_direction[a] > 0.0)
+                    ? (double)(lower[a] + mask + 1)
+                    : (double)lower[a];
+                double const axis_t = (bound - _origin[a]) / _direction[a];
+                if (axis_t < exit_t)
+                {
+                    exit_t = axis_t;
+                    exit_axis = a;
+                }
+            }
+
+            if (exit_t == std::numeric_limits<double>::infinity())
+                return false;
+
+            t = std::max(t, exit_t);
+            for (unsigned a = 0u; a < 3u; ++a)
+            {
+                if (a == exit_axis)
+                    p[a] = (_direction[a] > 0.0) ? lower[a] + mask + 1 : lower[a] - 1;
+                else
+                {
+                    Integer_t const c = (Integer_t)std::floor(_origin[a] + _direction[a] * t);
+                    p[a] = std::min(std::max(c, lower[a]), lower[a] + mask);
+                }
+            }
+        }
+
+        return false;
+    }
+
+    template <typename NodeT>
+    static constexpr std::size_t NodeWords()
+    {
+        if constexpr (NodeT::kNodeLevel == 0u)
+            return NodeT::Bits_t::kArraySize;
+        else
+        {
+            constexpr std::size_t kBitWords = NodeT::Bits_t::kArraySize;
+            return kBitWords * 2u + (kBitWords + 2u) / 2u;
+        }
+    }
+
+private:
+    std::uint64_t const *RootEntry_(std::size_t _i) const
+    {
+        return data_ + kHeaderWords + _i * kRootEntryWords;
+    }
+
+    static Position_t RootEntryBase_(std::uint64_t const *_entry)
+    {
+        return { (Integer_t)_entry[0], (Integer_t)_entry[1], (Integer_t)_entry[2] };
+    }
+
+    std::uint64_t const *FindRoot_(Position_t const &_key) const
+    {
+        std::size_t first = 0u;
+        std::size_t count = rootCount();
+        while (count > 0u)
+        {
+            std::size_t const half = count / 2u;
+            if (PositionLess_(RootEntryBase_(RootEntry_(first + half)), _key))
+            {
+                first += half + 1u;
+                count -= half + 1u;
+            }
+            else
+                count = half;
+        }
+
+        if (first < rootCount() && RootEntryBase_(RootEntry_(first)) == _key)
+            return RootEntry_(first);
+        return nullptr;
+    }
+
+    // 32 bits integer _i of the packed array following the bits of a branch
+    std::uint64_t Packed_(std::uint64_t _offset, std::size_t _i) const
+    {
+        return (data_[_offset + _i / 2u] >> ((_i & 1u) * 32u)) & 0xffffffffull;
+    }
+
+    template <typename NodeT>
+    std::uint64_t ChildOffset_(std::uint64_t _offset, std::size_t _index) const
+    {
+        constexpr std::size_t kBitWords = NodeT::Bits_t::kArraySize;
+        std::uint64_t const packed = _offset + kBitWords * 2u;
+        std::size_t const word = _index / 64u;
+        std::uint64_t const below = data_[_offset + word] & ((1ull << (_index & 63u)) - 1ull);
+        std::uint64_t const rank = Packed_(packed, word) + Popcount_(below);
+        return Packed_(packed, kBitWords) + rank * NodeWords<typename NodeT::ChildT>();
+    }
+
+    // Value and size of the uniform region containing _p
+    void Probe_(Position_t const &_p, bool *_active, unsigned *_log2_side) const
+    {
+        using Child = typename VDB::ChildT;
+        constexpr Integer_t kChildMask = (Integer_t(1) << Child::kLog2Side) - 1;
+        std::uint64_t const *entry = FindRoot_({ _p[0] & ~kChildMask, _p[1] & ~kChildMask, _p[2] & ~kChildMask });
+        if (entry == nullptr || !(entry[3] & 1ull))
+        {
+            *_active = (entry != nullptr) && (entry[3] & 2ull);
+            *_log2_side = Child::kLog2Side;
+        }
+        else
+            Probe_<Child>(entry[3] >> 2u, _p, _active, _log2_side);
+    }
+
+    template <typename NodeT>
+    void Probe_(std::uint64_t _offset, Position_t const &_p, bool *_active, unsigned *_log2_side) const
+    {
+        std::size_t const index = NodeT::BitIndex_(_p);
+        std::uint64_t const bit = 1ull << (index & 63u);
+        if constexpr (NodeT::kNodeLevel == 0u)
+        {
+            *_active = (data_[_offset + index / 64u] & bit) != 0ull;
+            *_log2_side = 0u;
+        }
+        else
+        {
+            constexpr std::size_t kBitWords = NodeT::Bits_t::kArraySize;
+            if (data_[_offset + index / 64u] & bit)
+                Probe_<typename NodeT::ChildT>(ChildOffset_<NodeT>(_offset, index), _p, _active, _log2_side);
+            else
+            {
+                *_active = (data_[_offset + kBitWords + index / 64u] & bit) != 0ull;
+                *_log2_side = NodeT::ChildT::kLog2Side;
+            }
+        }
+    }
+
+    template <typename NodeT, typename F>
+    void ForEachLeaf_(std::uint64_t _offset, Position_t const &_base, F &_f) const
+    {
+        if constexpr (NodeT::kNodeLevel == 0u)
+            _f(data_ + _offset, _base);
+        else
+        {
+            constexpr std::size_t kBitWords = NodeT::Bits_t::kArraySize;
+            std::uint64_t child_offset = Packed_(_offset + kBitWords * 2u, kBitWords);
+            for (std::size_t w = 0u; w < kBitWords; ++w)
+                for (std::uint64_t word = data_[_offset + w]; word != 0ull; word &= word - 1ull)
+                {
+                    std::size_t const index = w * 64u + Ctz_(word);
+                    ForEachLeaf_<typename NodeT::ChildT>(child_offset, NodeT::ChildBaseFromIndex_(_base, index), _f);
+                    child_offset += NodeWords<typename NodeT::ChildT>();
+                }
+        }
+    }
+
+    template <typename NodeT, typename F>
+    void ForEachActiveTile_(std::uint64_t _offset, Position_t const &_base, F &_f) const
+    {
+        if constexpr (NodeT::kNodeLevel != 0u)
+        {
+            constexpr std::size_t kBitWords = NodeT::Bits_t::kArraySize;
+            constexpr Unsigned_t kTileSide = 1ull << NodeT::ChildT::kLog2Side;
+            std::uint64_t child_offset = Packed_(_offset + kBitWords * 2u, kBitWords);
+            for (std::size_t w = 0u; w < kBitWords; ++w)
+            {
+                std::uint64_t const children = data_[_offset + w];
+                std::uint64_t const tiles = data_[_offset + kBitWords + w] & ~children;
+                for (std::uint64_t word = tiles; word != 0ull; word &= word - 1ull)
+                    _f(Box_t{ NodeT::ChildBaseFromIndex_(_base, w * 64u + Ctz_(word)),
+                              Extent_t{ kTileSide, kTileSide, kTileSide } });
+
+                for (std::uint64_t word = children; word != 0ull; word &= word - 1ull)
+                {
+                    std::size_t const index = w * 64u + Ctz_(word);
+                    ForEachActiveTile_<typename NodeT::ChildT>(child_offset, NodeT::ChildBaseFromIndex_(_base, index), _f);
+                    child_offset += NodeWords<typename NodeT::ChildT>();
+                }
+            }
+        }
+    }
+
+private:
+    std::uint64_t const *data_ = nullptr;
+    std::size_t word_count_ = 0u;
+};
+
+// Owns the buffer of a baked tree. Baking fails, leaving the tree invalid,
+// when the buffer would not be addressable with 32 bits offsets.
+template <typename VDB>
+class BakedTree
+{
+public:
+    using View_t = BakedView<VDB>;
+    static_assert(HasWordStorage_<typename VDB::LeafT::Bits_t>::value, "BakedTree " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+
+    BakedTree() = default;
+
+    explicit BakedTree(VDB const &_vdb)
+    {
+        Bake_(_vdb);
+    }
+
+    // Copies a buffer previously obtained from data()
+    BakedTree(std::uint64_t const *_data, std::size_t _word_count)
+        : storage_(_data, _data + _word_count)
+    {}
+
+    View_t view() const { return View_t{ storage_.data(), storage_.size() }; }
+    bool valid() const { return view().valid(); }
+    bool get(Position_t const &_p) const { return view().get(_p); }
+
+    std::uint64_t const *data() const { return storage_.data(); }
+    std::size_t wordCount() const { return storage_.size(); }
+
+private:
+    using Child = typename VDB::ChildT;
+
+    void Bake_(VDB const &_vdb)
+    {
+        std::vector<std::pair<Position_t, typename VDB::RootData const*>> entries{};
+        for (typename VDB::RootMap_t::value_type const &entry : _vdb.root_map_)
+        {
+            // Inactive leftovers of reset() carry no information
+            if (entry.second.child_ != nullptr || entry.second.active_)
+                entries.emplace_back((Position_t)entry.first, &entry.second);
+        }
+        std::sort(entries.begin(), entries.end(), [](auto const &_lhs, auto const &_rhs) {
+            return PositionLess_(_lhs.first, _rhs.first);
+        });
+
+        std::size_t const nodes_offset = View_t::kHeaderWords + entries.size() * View_t::kRootEntryWords;
+        storage_.assign(nodes_offset, 0ull);
+        storage_[0] = View_t::kMagic;
+        storage_[1] = View_t::Signature();
+        storage_[2] = entries.size();
+
+        std::vector<Child const*> children{};
+        for (std::size_t i = 0u; i < entries.size(); ++i)
+        {
+            std::uint64_t *entry = &storage_[View_t::kHeaderWords + i * View_t::kRootEntryWords];
+            entry[0] = (std::uint64_t)entries[i].first[0];
+            entry[1] = (std::uint64_t)entries[i].first[1];
+            entry[2] = (std::uint64_t)entries[i].first[2];
+            if (entries[i].second->child_ != nullptr)
+            {
+                std::uint64_t const offset = nodes_offset + children.size() * View_t::template NodeWords<Child>();
+                entry[3] = (offset << 2u) | 1ull;
+                children.push_back(entries[i].second->child_.get());
+            }
+            else
+                entry[3] = 2ull;
+        }
+
+        BakeLevel_<Child>(children, nodes_offset);
+
+        if (storage_.size() > 0xffffffffull)
+            storage_.clear();
+        else
+            storage_[3] = storage_.size();
+    }
+
+    template <typename NodeT>
+    void BakeLevel_(std::vector<NodeT const*> const &_nodes, std::size_t _offset)
+    {
+        constexpr std::size_t kNodeWords = View_t::template NodeWords<NodeT>();
+        constexpr std::size_t kBitWords = NodeT::Bits_t::kArraySize;
+        storage_.resize(_offset + _nodes.size() * kNodeWords, 0ull);
+
+        if constexpr (NodeT::kNodeLevel == 0u)
+        {
+            for (std::size_t i = 0u; i < _nodes.size(); ++i)
+                for (std::size_t w = 0u; w < kBitWords; ++w)
+                    storage_[_offset + i * kNodeWords + w] = _nodes[i]->activeBits().storage[w];
+        }
+        else
+        {
+            using ChildT = typename NodeT::ChildT;
+            std::size_t const next_offset = _offset + _nodes.size() * kNodeWords;
+            std::vector<ChildT const*> children{};
+
+            for (std::size_t i = 0u; i < _nodes.size(); ++i)
+            {
+                NodeT const &node = *_nodes[i];
+                std::uint64_t *words = &storage_[_offset + i * kNodeWords];
+                std::uint64_t *packed = words + kBitWords * 2u;
+                auto pack = [packed](std::size_t _j, std::uint64_t _value) {
+                    packed[_j / 2u] |= (_value & 0xffffffffull) << ((_j & 1u) * 32u);
+                };
+
+                std::uint64_t rank = 0u;
+                for (std::size_t w = 0u; w < kBitWords; ++w)
+                {
+                    words[w] = node.childBits().storage[w];
+                    words[kBitWords + w] = node.activeBits().storage[w];
+                    pack(w, rank);
+                    rank += Popcount_(words[w]);
+                }
+                pack(kBitWords, next_offset + children.size() * View_t::template NodeWords<ChildT>());
+
+                node.childBits().forEachSet([&](std::size_t _index) {
+                    children.push_back(node.child(_index));
+                });
+            }
+
+            BakeLevel_<ChildT>(children, next_offset);
+        }
+    }
+
+private:
+    std::vector<std::uint64_t> storage_{};
+};
+
+// =============================================================================
+// CONCURRENT WRITES
+// =============================================================================
+
+template <typename T, unsigned Level, bool Match = (T::kNodeLevel == Level)>
+struct NodeAtLevel
+{
+    using type = typename NodeAtLevel<typename T::ChildT, Level>::type;
+};
+
+template <typename T, unsigned Level>
+struct NodeAtLevel<T, Level, true>
+{
+    using type = T;
+};
+
+// Root node accepting writes from several threads at once.
+// Root entries are spread over shards, each guarded by a shared mutex that is
+// only taken exclusively to insert an entry. Entries are never removed before
+// clear(), and everything below an entry is guarded by the entry's own mutex.
+// Each thread writes through its own Writer, which caches the last entry and
+// the last visited nodes. The node cache is dropped whenever another writer
+// modified the entry in between. clear() and extract() free the entries, they
+// bump a generation counter so that writers created before drop their cached
+// entry and nodes on their next access.
+template <typename Child, unsigned Log2ShardCount>
+class ConcurrentRootNode
+{
+public:
+    static constexpr unsigned kNodeLevel = Child::kNodeLevel + 1u;
+    using ChildT = Child;
+    using LeafT = typename Child::LeafT;
+    using RootKey_t = Position_t;
+
+    class Writer;
+
+    ConcurrentRootNode() = default;
+
+    // Takes over the content of _root
+    explicit ConcurrentRootNode(RootNode<Child> &&_root)
+    {
+        for (typename RootNode<Child>::RootMap_t::value_type &entry : _root.root_map_)
+        {
+            Entry_ &target = *Insert_((RootKey_t)entry.first);
+            target.child_ = std::move(entry.second.child_);
+            target.active_ = entry.second.active_;
+        }
+        _root.clear();
+    }
+
+    ConcurrentRootNode(ConcurrentRootNode const&) = delete;
+    ConcurrentRootNode &operator=(ConcurrentRootNode const&) = delete;
+
+    // Uncached convenience accessors, prefer a Writer per thread
+    void set(Position_t const &_p, bool const _v = true) { Writer{ *this }.set(_p, _v); }
+    void reset(Position_t const &_p) { set(_p, false); }
+    bool get(Position_t const &_p) { return Writer{ *this }.get(_p); }
+
+    // Neither clear() nor extract() may run concurrently with writers
+    void clear()
+    {
+        for (Shard_ &shard : shards_)
+            shard.map_.clear();
+        generation_.fetch_add(1u, std::memory_order_release);
+    }
+
+    // Moves the content into _out, which is cleared first
+    void extract(RootNode<Child> &_out)
+    {
+        _out.clear();
+        for (Shard_ &shard : shards_)
+        {
+            for (typename ShardMap_t::value_type &entry : shard.map_)
+            {
+                if (entry.second->child_ == nullptr && !entry.second->active_)
+                    continue;
+                _out.root_map_[entry.first] = typename RootNode<Child>::RootData{
+                    std::move(entry.second->child_), entry.second->active_
+                };
+            }
+            shard.map_.clear();
+        }
+        generation_.fetch_add(1u, std::memory_order_release);
+    }
+
+private:
+    struct alignas(64) Entry_
+    {
+        std::mutex mutex_{};
+        std::unique_ptr<Child> child_{ nullptr };
+        bool active_ = false;
+        void const *last_writer_ = nullptr;
+    };
+
+    using ShardMap_t = std::unordered_map<RootKey_t, std::unique_ptr<Entry_>, PositionHash>;
+
+    struct alignas(64) Shard_
+    {
+        std::shared_mutex mutex_{};
+        ShardMap_t map_{};
+    };
+
+    static constexpr std::size_t kShardCount = std::size_t(1) << Log2ShardCount;
+
+    static RootKey_t RootKey_(Position_t const &_p)
+    {
+        return NodeBase_<Child>(_p);
+    }
+
+    Shard_ &ShardOf_(RootKey_t const &_key)
+    {
+        return shards_[(PositionHash{}(_key) >> 7u) & (kShardCount - 1u)];
+    }
+
+    Entry_ *Find_(RootKey_t const &_key)
+    {
+        Shard_ &shard = ShardOf_(_key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+        typename ShardMap_t::iterator const nit = shard.map_.find(_key);
+        return (nit != shard.map_.end()) ? nit->second.get() : nullptr;
+    }
+
+    Entry_ *Insert_(RootKey_t const &_key)
+    {
+        if (Entry_ *entry = Find_(_key))
+            return entry;
+
+        Shard_ &shard = ShardOf_(_key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        std::unique_ptr<Entry_> &slot = shard.map_[_key];
+        if (slot == nullptr)
+            slot.reset(new Entry_{});
+        return slot.get();
+    }
+
+private:
+    std::array<Shard_, kShardCount> shards_{};
+    std::atomic<std::uint64_t> generation_{ 0u };
+
+public:
+    // Per thread write handle. A Writer must not be shared between threads
+    // and must not outlive its ConcurrentRootNode. It can be kept across
+    // clear() and extract().
+    class Writer
+    {
+    public:
+        explicit Writer(ConcurrentRootNode &_root)
+            : root_{ _root },
+              generation_{ _root.generation_.load(std::memory_order_acquire) }
+        {
+            InvalidateCache_();
+        }
+
+        void set(Position_t const &_p, bool const _v = true)
+        {
+            RootKey_t const key = RootKey_(_p);
+            Entry_ &entry = *Lookup_(key, true);
+            std::lock_guard<std::mutex> lock(entry.mutex_);
+            Acquire_(entry);
+
+#ifdef QVDB_ENABLE_CACHE
+            if (SetCached_<0u>(_p, _v))
+                return;
+#endif
+
+            if (entry.child_ == nullptr)
+            {
+                if (_v != entry.active_)
+                {
+                    entry.child_.reset(new Child(entry.active_, key));
+                    entry.child_->set(Cache_(), _p, _v);
+#ifdef QVDB_ENABLE_CACHE
+                    node_cache_[kNodeLevel-1u] = CacheEntry{ key, (void*)entry.child_.get() };
+#endif
+                }
+            }
+            else
+            {
+                entry.child_->set(Cache_(), _p, _v);
+
+                bool all = entry.child_->all();
+                bool none = entry.child_->none();
+                if (all != none)
+                {
+                    entry.active_ = all;
+                    entry.child_.reset(nullptr);
+                    InvalidateCache_();
+                }
+            }
+        }
+
+        void reset(Position_t const &_p) { set(_p, false); }
+
+        bool get(Position_t const &_p)
+        {
+            Entry_ *entry = Lookup_(RootKey_(_p), false);
+            if (entry == nullptr)
+                return false;
+
+            std::lock_guard<std::mutex> lock(entry->mutex_);
+            Acquire_(*entry);
+            if (entry->child_ == nullptr)
+                return entry->active_;
+            return entry->child_->get(Cache_(), _p);
+        }
+
+    private:
+        Entry_ *Lookup_(RootKey_t const &_key, bool _insert)
+        {
+            // Entries and their nodes were freed by clear() or extract()
+            std::uint64_t const generation = root_.generation_.load(std::memory_order_acquire);
+            if (generation != generation_)
+            {
+                entry_ = nullptr;
+                generation_ = generation;
+                InvalidateCache_();
+            }
+
+            if (entry_ != nullptr && key_ == _key)
+                return entry_;
+
+            Entry_ *entry = _insert ? root_.Insert_(_key) : root_.Find_(_key);
+            if (entry != nullptr)
+            {
+                entry_ = entry;
+                key_ = _key;
+            }
+            return entry;
+        }
+
+        // Cached nodes of the entry may have been freed by another writer
+        void Acquire_(Entry_ &_entry)
+        {
+            if (_entry.last_writer_ != this)
+            {
+                InvalidateCache_();
+                _entry.last_writer_ = this;
+            }
+        }
+
+        CacheEntry *Cache_()
+        {
+#ifdef QVDB_ENABLE_CACHE
+            return node_cache_;
+#else
+            return nullptr;
+#endif
+        }
+
+        void InvalidateCache_()
+        {
+#ifdef QVDB_ENABLE_CACHE
+            for (unsigned i = 0u; i < kNodeLevel; ++i)
+                node_cache_[i] = CacheEntry{ Position_t{}, nullptr };
+#endif
+        }
+
+#ifdef QVDB_ENABLE_CACHE
+        // Forwards the write to the deepest cached node containing _p, if any
+        template <unsigned Level>
+        bool SetCached_(Position_t const &_p, bool const _v)
+        {
+            if constexpr (Level + 1u >= kNodeLevel)
+                return false;
+            else
+            {
+                using NodeT = typename NodeAtLevel<Child, Level>::type;
+                CacheEntry const &cached = node_cache_[Level];
+                if (cached.node != nullptr && cached.base == NodeBase_<NodeT>(_p))
+                {
+                    reinterpret_cast<NodeT*>(cached.node)->set(node_cache_, _p, _v);
+                    return true;
+                }
+                return SetCached_<Level + 1u>(_p, _v);
+            }
+        }
+
+        CacheEntry node_cache_[kNodeLevel];
+#endif
+
+    private:
+        ConcurrentRootNode &root_;
+        Entry_ *entry_ = nullptr;
+        RootKey_t key_{};
+        std::uint64_t generation_;
+    };
+};
+
+// =============================================================================
+// PROXIMITY QUERIES
+// =============================================================================
+
+// Nearest active voxel and radius searches over a RootNode.
+// Nodes are visited best first by the distance to their box, empty storage words of
+// the child and active bitsets are skipped, and so are words whose cells lie too far.
+// Queries only read the tree, they can run concurrently as long as nothing writes.
+template <typename VDB>
+class ProximityQuery
+{
+public:
+    using Child = typename VDB::ChildT;
+    static_assert(HasWordStorage_<typename VDB::LeafT::Bits_t>::value, "Proximity queries " "requires quick_vdb::Bitset, unavailable with QVDB_STD_BITSET");
+
+    static NearestResult_t Nearest(VDB const &_vdb, Position_t const &_p, double _max_dist)
+    {
+        std::vector<Candidate_> heap{};
+        return Nearest_(_vdb, _p, _max_dist, heap);
+    }
+
+    static void NearestBatch(VDB const &_vdb, WorkStealingPool *_pool, std::vector<Position_t> const &_points,
+                             double _max_dist, std::vector<NearestResult_t> &_out)
+    {
+        constexpr std::size_t kChunkSize = 64u;
+        _out.resize(_points.size());
+        auto process = [&](std::size_t _begin) {
+            std::vector<Candidate_> heap{};
+            std::size_t const end = std::min(_begin + kChunkSize, _points.size());
+            for (std::size_t i = _begin; i < end; ++i)
+                _out[i] = Nearest_(_vdb, _points[i], _max_dist, heap);
+        };
+
+        if (_pool != nullptr)
+        {
+            for (std::size_t begin = 0u; begin < _points.size(); begin += kChunkSize)
+                _pool->push([&process, begin]() { process(begin); });
+            _pool->wait();
+        }
+        else
+        {
+            for (std::size_t begin = 0u; begin < _points.size(); begin += kChunkSize)
+                process(begin);
+        }
+    }
+
+    static void Radius(VDB const &_vdb, Position_t const &_p, double _radius, std::vector<Position_t> &_out)
+    {
+        if (!(_radius >= 0.0))
+            return;
+
+        std::size_t const first = _out.size();
+        Sphere_ const sphere{ _p, _radius * _radius, (Integer_t)std::floor(_radius) };
+        for (typename VDB::RootMap_t::value_type const &entry : _vdb.root_map_)
+        {
+            Position_t const base = VDB::ChildBase_(entry.first);
+            if (entry.second.child_ != nullptr)
+            {
+                if (BoxDistance2_(_p, base, NodeMax_<Child>(base)) <= sphere.radius2)
+                    Gather_(*entry.second.child_, base, sphere, _out);
+            }
+            else if (entry.second.active_)
+                GatherBox_(base, NodeMax_<Child>(base), sphere, _out);
+        }
+        std::sort(_out.begin() + first, _out.end(), PositionLess_);
+    }
+
+private:
+    struct Search_;
+
+    struct Candidate_
+    {
+        double distance2;
+        void const *node;
+        Position_t base;
+        void (*expand)(Search_&, void const*, Position_t const&);
+
+        bool operator>(Candidate_ const &_rhs) const { return distance2 > _rhs.distance2; }
+    };
+
+    struct Search_
+    {
+        Position_t p;
+        double best2;
+        Position_t best;
+        bool found;
+        std::vector<Candidate_> &heap;
+
+        // Inclusive at the initial bound so that voxels exactly at _max_dist are found
+        bool Improves(double _distance2) const
+        {
+            return _distance2 < best2 || (!found && _distance2 <= best2);
+        }
+    };
+
+    struct Sphere_
+    {
+        Position_t center;
+        double radius2;
+        Integer_t extent; // integer half side of the bounding cube
+    };
+
+    static double Distance2_(Position_t const &_lhs, Position_t const &_rhs)
+    {
+        double distance2 = 0.0;
+        for (unsigned axis = 0u; axis < 3u; ++axis)
+        {
+            double const d = (double)(_lhs[axis] - _rhs[axis]);
+            distance2 += d * d;
+        }
+        return distance2;
+    }
+
+    // Squared distance from _p to the closest voxel of the inclusive box [_lo, _hi]
+    static double BoxDistance2_(Position_t const &_p, Position_t const &_lo, Position_t const &_hi)
+    {
+        Position_t closest{};
+        for (unsigned axis = 0u; axis < 3u; ++axis)
+            closest[axis] = std::clamp(_p[axis], _lo[axis], _hi[axis]);
+        return Distance2_(_p, closest);
+    }
+
+    template <typename NodeT>
+    static Position_t NodeMax_(Position_t const &_base)
+    {
+        constexpr Integer_t kSide = (Integer_t)1 << NodeT::kLog2Side;
+        return { _base[0] + kSide - 1, _base[1] + kSide - 1, _base[2] + kSide - 1 };
+    }
+
+    // Bounds of the cells of storage word _w in a node of 2^Log2Count cells per side,
+    // cells being 2^CellLog2Side voxels wide. A word spans whole slices, whole rows,
+    // or part of a row depending on the node side.
+    template <std::size_t Log2Count, std::size_t CellLog2Side>
+    static void WordBounds_(Position_t const &_base, std::size_t _w, Position_t *_lo, Position_t *_hi)
+    {
+        constexpr std::size_t kMask = (1u << Log2Count) - 1u;
+        std::size_t const first = _w * 64u;
+        std::array<std::size_t, 3u> lo{ first & kMask, (first >> Log2Count) & kMask, first >> (Log2Count * 2u) };
+        std::array<std::size_t, 3u> hi = lo;
+        if constexpr (Log2Count * 2u <= 6u)
+        {
+            lo[0] = 0u; hi[0] = kMask;
+            lo[1] = 0u; hi[1] = kMask;
+            hi[2] = lo[2] + (64u >> (Log2Count * 2u)) - 1u;
+        }
+        else if constexpr (Log2Count <= 6u)
+        {
+            lo[0] = 0u; hi[0] = kMask;
+            hi[1] = lo[1] + (64u >> Log2Count) - 1u;
+        }
+        else
+            hi[0] = lo[0] + 63u;
+
+        for (unsigned axis = 0u; axis < 3u; ++axis)
+        {
+            (*_lo)[axis] = _base[axis] + (Integer_t)(lo[axis] << CellLog2Side);
+            (*_hi)[axis] = _base[axis] + (Integer_t)((hi[axis] + 1u) << CellLog2Side) - 1;
+        }
+    }
+
+    static void Offer_(Search_ &_search, Position_t const &_lo, Position_t const &_hi)
+    {
+        Position_t closest{};
+        for (unsigned axis = 0u; axis < 3u; ++axis)
+            closest[axis] = std::clamp(_search.p[axis], _lo[axis], _hi[axis]);
+        double const distance2 = Distance2_(_search.p, closest);
+        if (_search.Improves(distance2))
+        {
+            _search.best2 = distance2;
+            _search.best = closest;
+            _search.found = true;
+        }
+    }
+
+    static void Push_(Search_ &_search, Candidate_ const &_candidate)
+    {
+        _search.heap.push_back(_candidate);
+        std::push_heap(_search.heap.begin(), _search.heap.end(), std::greater<Candidate_>{});
+    }
+
+    template <typename NodeT>
+    static void Expand_(Search_ &_search, void const *_node, Position_t const &_base)
+    {
+        NodeT const &node = *static_cast<NodeT const*>(_node);
+        Position_t lo{}, hi{};
+
+        if constexpr (NodeT::kNodeLevel == 0u)
+        {
+            constexpr std::size_t kLog2Side = NodeT::kLog2Side;
+            constexpr std::size_t kMask = (1u << kLog2Side) - 1u;
+            for (std::size_t w = 0u; w < NodeT::Bits_t::kArraySize; ++w)
+            {
+                std::uint64_t const voxels = node.activeBits().storage[w];
+                if (voxels == 0ull)
+                    continue;
+                WordBounds_<kLog2Side, 0u>(_base, w, &lo, &hi);
+                if (!_search.Improves(BoxDistance2_(_search.p, lo, hi)))
+                    continue;
+
+                for (std::uint64_t word = voxels; word != 0ull; word &= word - 1ull)
+                {
+                    std::size_t const i = w * 64u + Ctz_(word);
+                    Position_t const voxel{
+                        _base[0] + (Integer_t)(i & kMask),
+                        _base[1] + (Integer_t)((i >> kLog2Side) & kMask),
+                        _base[2] + (Integer_t)(i >> (kLog2Side * 2u))
+                    };
+                    Offer_(_search, voxel, voxel);
+                }
+            }
+        }
+        else
+        {
+            using ChildT = typename NodeT::ChildT;
+            for (std::size_t w = 0u; w < NodeT::Bits_t::kArraySize; ++w)
+            {
+                std::uint64_t const children = node.childBits().storage[w];
+                std::uint64_t const tiles = node.activeBits().storage[w] & ~children;
+                if ((children | tiles) == 0ull)
+                    continue;
+                WordBounds_<NodeT::kInternalLog2Side, ChildT::kLog2Side>(_base, w, &lo, &hi);
+                if (!_search.Improves(BoxDistance2_(_search.p, lo, hi)))
+                    continue;
+
+                for (std::uint64_t word = tiles; word != 0ull; word &= word - 1ull)
+                {
+                    Position_t const tile_base = NodeT::ChildBaseFromIndex_(_base, w * 64u + Ctz_(word));
+                    Offer_(_search, tile_base, NodeMax_<ChildT>(tile_base));
+                }
+                for (std::uint64_t word = children; word != 0ull; word &= word - 1ull)
+                {
+                    std::size_t const i = w * 64u + Ctz_(word);
+                    Position_t const child_base = NodeT::ChildBaseFromIndex_(_base, i);
+                    double const distance2 = BoxDistance2_(_search.p, child_base, NodeMax_<ChildT>(child_base));
+                    if (_search.Improves(distance2))
+                        Push_(_search, Candidate_{ distance2, node.child(i), child_base, &Expand_<ChildT> });
+                }
+            }
+        }
+    }
+
+    static NearestResult_t Nearest_(VDB const &_vdb, Position_t const &_p, double _max_dist,
+                                    std::vector<Candidate_> &_heap)
+    {
+        if (!(_max_dist >= 0.0))
+            return NearestResult_t{ _p, 0.0, false };
+
+        _heap.clear();
+        Search_ search{ _p, _max_dist * _max_dist, _p, false, _heap };
+        for (typename VDB::RootMap_t::value_type const &entry : _vdb.root_map_)
+        {
+            Position_t const base = VDB::ChildBase_(entry.first);
+            if (entry.second.child_ != nullptr)
+            {
+                double const distance2 = BoxDistance2_(_p, base, NodeMax_<Child>(base));
+                if (search.Improves(distance2))
+                    Push_(search, Candidate_{ distance2, entry.second.child_.get(), base, &Expand_<Child> });
+            }
+            else if (entry.second.active_)
+                Offer_(search, base, NodeMax_<Child>(base));
+        }
+
+        while (!_heap.empty())
+        {
+            std::pop_heap(_heap.begin(), _heap.end(), std::greater<Candidate_>{});
+            Candidate_ const candidate = _heap.back();
+            _heap.pop_back();
+            // Candidates come out by increasing distance, nothing left can do better
+            if (!search.Improves(candidate.distance2))
+                break;
+            candidate.expand(search, candidate.node, candidate.base);
+        }
+
+        return NearestResult_t{ search.best, search.found ? std::sqrt(search.best2) : 0.0, search.found };
+    }
+
+    // Visits the voxels of the box clipped to the bounding cube of the sphere
+    static void GatherBox_(Position_t const &_lo, Position_t const &_hi, Sphere_ const &_sphere,
+                           std::vector<Position_t> &_out)
+    {
+        Position_t lo{}, hi{};
+        for (unsigned axis = 0u; axis < 3u; ++axis)
+        {
+            lo[axis] = std::max(_lo[axis], _sphere.center[axis] - _sphere.extent);
+            hi[axis] = std::min(_hi[axis], _sphere.center[axis] + _sphere.extent);
+            if (lo[axis] > hi[axis])
+                return;
+        }
+
+        for (Integer_t z = lo[2]; z <= hi[2]; ++z)
+            for (Integer_t y = lo[1]; y <= hi[1]; ++y)
+                for (Integer_t x = lo[0]; x <= hi[0]; ++x)
+                {
+                    Position_t const voxel{ x, y, z };
+                    if (Distance2_(_sphere.center, voxel) <= _sphere.radius2)
+                        _out.push_back(voxel);
+                }
+    }
+
+    template <typename NodeT>
+    static void Gather_(NodeT const &_node, Position_t const &_base, Sphere_ const &_sphere,
+                        std::vector<Position_t> &_out)
+    {
+        Position_t lo{}, hi{};
+
+        if constexpr (NodeT::kNodeLevel == 0u)
+        {
+            constexpr std::size_t kLog2Side = NodeT::kLog2Side;
+            constexpr std::size_t kMask = (1u << kLog2Side) - 1u;
+            for (std::size_t w = 0u; w < NodeT::Bits_t::kArraySize; ++w)
+            {
+                std::uint64_t const voxels = _node.activeBits().storage[w];
+                if (voxels == 0ull)
+                    continue;
+                WordBounds_<kLog2Side, 0u>(_base, w, &lo, &hi);
+                if (BoxDistance2_(_sphere.center, lo, hi) > _sphere.radius2)
+                    continue;
+
+                for (std::uint64_t word = voxels; word != 0ull; word &= word - 1ull)
+                {
+                    std::size_t const i = w * 64u + Ctz_(word);
+                    Position_t const voxel{
+                        _base[0] + (Integer_t)(i & kMask),
+                        _base[1] + (Integer_t)((i >> kLog2Side) & kMask),
+                        _base[2] + (Integer_t)(i >> (kLog2Side * 2u))
+                    };
+                    if (Distance2_(_sphere.center, voxel) <= _sphere.radius2)
+                        _out.push_back(voxel);
+                }
+            }
+        }
+        else
+        {
+            using ChildT = typename NodeT::ChildT;
+            for (std::size_t w = 0u; w < NodeT::Bits_t::kArraySize; ++w)
+            {
+                std::uint64_t const children = _node.childBits().storage[w];
+                std::uint64_t const tiles = _node.activeBits().storage[w] & ~children;
+                if ((children | tiles) == 0ull)
+                    continue;
+                WordBounds_<NodeT::kInternalLog2Side, ChildT::kLog2Side>(_base, w, &lo, &hi);
+                if (BoxDistance2_(_sphere.center, lo, hi) > _sphere.radius2)
+                    continue;
+
+                for (std::uint64_t word = tiles; word != 0ull; word &= word - 1ull)
+                {
+                    Position_t const tile_base = NodeT::ChildBaseFromIndex_(_base, w * 64u + Ctz_(word));
+                    GatherBox_(tile_base, NodeMax_<ChildT>(tile_base), _sphere, _out);
+                }
+                for (std::uint64_t word = children; word != 0ull; word &= word - 1ull)
+                {
+                    std::size_t const i = w * 64u + Ctz_(word);
+                    Position_t const child_base = NodeT::ChildBaseFromIndex_(_base, i);
+                    if (BoxDistance2_(_sphere.center, child_base, NodeMax_<ChildT>(child_base)) <= _sphere.radius2)
+                        Gather_(*_node.child(i), child_base, _sphere, _out);
+                }
+            }
+        }
+    }
+};
+
 } // namespace quick_vdb
@@ -31,6 +31,7 @@ static constexpr std::size_t kLeafSide = 3u;
 static constexpr std::size_t kBranch1Side = 3u;
 using OneLevelVDB_t = quick_vdb::RootNode<quick_vdb::LeafNode<kLeafSide>>;
 using TwoLevelVDB_t = quick_vdb::RootNode<quick_vdb::BranchNode<quick_vdb::LeafNode<kLeafSide>, kBranch1Side>>;
+using CompactTwoLevelVDB_t = quick_vdb::RootNode<quick_vdb::CompactBranchNode<quick_vdb::LeafNode<kLeafSide>, kBranch1Side>>;
 
 #define LOG_UNIT_TEST(func)										\
 	if (func())													\
@@ -53,6 +54,39 @@ void UnitTests()
 	LOG_UNIT_TEST(VDB::UnitTests::FirstLevelChildGet_FullChild_True);
 	LOG_UNIT_TEST(VDB::UnitTests::FirstLevelChildGet_FullChild_False);
 	LOG_UNIT_TEST(VDB::UnitTests::FirstLevelChildSet_FullChild_NeighbourTest);
+#ifndef QVDB_STD_BITSET
+	LOG_UNIT_TEST(VDB::UnitTests::ForEachLeaf_Count);
+	LOG_UNIT_TEST(VDB::UnitTests::ForEachLeaf_Base);
+	LOG_UNIT_TEST(VDB::UnitTests::ForEachLeaf_ParallelCount);
+	LOG_UNIT_TEST(VDB::UnitTests::ForEachNode_FirstLevelCount);
+	LOG_UNIT_TEST(VDB::UnitTests::ExtractSurface_SingleVoxel);
+	LOG_UNIT_TEST(VDB::UnitTests::ExtractSurface_GreedyMerge);
+	LOG_UNIT_TEST(VDB::UnitTests::ExtractSurface_AcrossLeaves);
+	LOG_UNIT_TEST(VDB::UnitTests::ExtractSurface_ParallelDeterministic);
+	LOG_UNIT_TEST(VDB::UnitTests::ExtractSurface_Tile);
+	LOG_UNIT_TEST(VDB::UnitTests::SetTile_GetInside);
+	LOG_UNIT_TEST(VDB::UnitTests::SetTile_LeafInBranch);
+	LOG_UNIT_TEST(VDB::UnitTests::LodPyramid_AnyOccupied);
+	LOG_UNIT_TEST(VDB::UnitTests::LodPyramid_Majority);
+	LOG_UNIT_TEST(VDB::UnitTests::LodPyramid_Incremental);
+	LOG_UNIT_TEST(VDB::UnitTests::LodPyramid_TilePropagation);
+#ifdef QVDB_ENABLE_JOURNAL
+	LOG_UNIT_TEST(VDB::UnitTests::Journal_RecordsLeaves);
+	LOG_UNIT_TEST(VDB::UnitTests::Journal_DeltaReplicates);
+#endif
+	LOG_UNIT_TEST(VDB::UnitTests::Bake_GetMatches);
+	LOG_UNIT_TEST(VDB::UnitTests::Bake_Relocatable);
+	LOG_UNIT_TEST(VDB::UnitTests::Bake_ForEach);
+	LOG_UNIT_TEST(VDB::UnitTests::Bake_Raycast);
+	LOG_UNIT_TEST(VDB::UnitTests::CompactChildren_RankOrder);
+	LOG_UNIT_TEST(VDB::UnitTests::Concurrent_DisjointWriters);
+	LOG_UNIT_TEST(VDB::UnitTests::Concurrent_SharedEntry);
+	LOG_UNIT_TEST(VDB::UnitTests::Concurrent_WriterAfterExtract);
+	LOG_UNIT_TEST(VDB::UnitTests::NearestActive_MatchesBruteForce);
+	LOG_UNIT_TEST(VDB::UnitTests::NearestActive_Tile);
+	LOG_UNIT_TEST(VDB::UnitTests::ActiveWithinRadius_MatchesBruteForce);
+	LOG_UNIT_TEST(VDB::UnitTests::NearestActive_Batched);
+#endif
 }
 
 int main()
@@ -61,5 +95,9 @@ int main()
 	UnitTests<OneLevelVDB_t>();
 	std::cout << "TwoLevelVDB tests" << std::endl;
 	UnitTests<TwoLevelVDB_t>();
+#ifndef QVDB_STD_BITSET
+	std::cout << "CompactTwoLevelVDB tests" << std::endl;
+	UnitTests<CompactTwoLevelVDB_t>();
+#endif
 	return 0;
 }